@@ -32,6 +32,8 @@ std::string ConsoleApp::Arguments(int argc, char* argv[])
 			std::cout << us;
 		return msg;				// m_argschecked is not set to true because in this case there is nothing to run
 	}
+	if (msg.size() == 0)
+		msg = StandardArguments();
 	if (msg.size() == 0)
 		msg = CheckArguments();
 	if (msg.size() != 0)
@@ -63,6 +65,8 @@ int ConsoleApp::Run()
 {
 	assert(m_argschecked && "Arguments must be parsed and checked first.");
 	int nbfiles{ 0 };
+	auto start = std::chrono::steady_clock::now();
+	m_run_stats = Run_Stats{};
 	try
 	{
 		PreProcess();
@@ -72,30 +76,793 @@ int ConsoleApp::Run()
 	catch (const std::exception&) {
 		throw;
 	}
+	if (m_stats)
+	{
+		m_run_stats.wall = std::chrono::steady_clock::now() - start;
+		std::vector<std::chrono::nanoseconds> walls{};
+		for (auto& f : m_run_stats.files)
+		{
+			m_run_stats.bytes += f.bytes;
+			m_run_stats.records += f.records;
+			m_run_stats.cpu += f.cpu;
+			walls.push_back(f.wall);
+		}
+		if (!walls.empty())
+		{
+			// nearest rank percentiles
+			std::sort(walls.begin(), walls.end());
+			m_run_stats.p50 = walls[(walls.size() * 50 + 99) / 100 - 1];
+			m_run_stats.p99 = walls[(walls.size() * 99 + 99) / 100 - 1];
+		}
+	}
 	return nbfiles;
 }
 
+void ConsoleApp::set_threads(unsigned int threads)
+{
+	if (threads == 0)
+		threads = std::thread::hardware_concurrency();
+	m_threads = threads == 0 ? 1 : threads;			// hardware_concurrency may be not computable
+}
+
+void ConsoleApp::AddThreadsArgument()
+{
+	Named_Arg t{ "threads" };
+	t.set_type(Argument_Type::string);
+	t.set_default_value("1");
+	t.helpstring = "Number of files processed simultaneously, 0 for one per available core.";
+	us.add_Argument(t);
+}
+
+void ConsoleApp::AddStatsArgument()
+{
+	Named_Arg s{ "stats" };
+	s.helpstring = "Collects the statistics of the processing of each file.";
+	us.add_Argument(s);
+}
+
+namespace
+{
+	constexpr char INVALID_VALUE[]{ "Invalid value '%s' for argument '%s' - see %s /? for help." };
+}
+
+std::string ConsoleApp::StandardArguments()
+{
+	auto t = us.get_Argument("threads");
+	if (t != NULL && !t->value.empty())
+	{
+		auto& value = t->value.front();
+		if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos || value.size() > 4)
+			return format_message<INVALID_VALUE>(value, t->name(), us.program_name);
+		set_threads(static_cast<unsigned int>(std::stoul(value)));
+	}
+	auto s = us.get_Argument("stats");
+	if (s != NULL && !s->value.empty())
+		set_statistics(true);
+	return "";
+}
+
 int ConsoleApp::ByFile()
 {
-	int nbfiles{ 0 };
 	auto files = us.get_Argument("file");
 	if (files == NULL || !files->required() && files->value.empty())
-		return nbfiles;
+		return 0;
+	if (m_streaming)
+		return ByFileStreaming(files->value);
+	std::vector<std::filesystem::path> filelist{};
+	File_Set files_set{};			// a file matching several patterns is processed once
 	for (auto value : files->value)
 	{
-		auto filelist = dir(value);
-		for (auto file : filelist)
+		for (auto& file : dir(value, {}, m_threads))
+			if (files_set.insert(file))
+				filelist.push_back(file);
+	}
+	if (filelist.empty())
+		throw std::filesystem::filesystem_error("No matching file.", std::make_error_code(std::errc::no_such_file_or_directory));
+	if (m_stats)
+		m_run_stats.files.assign(filelist.size(), File_Stats{});
+	if (m_threads > 1 && filelist.size() > 1)
+		ByFileParallel(filelist);
+	else
+	{
+		constexpr size_t PREFETCH_DEPTH{ 2 };
+		m_workers_stats.assign(1, Worker_Stats{});
+		auto& stats = m_workers_stats.front();
+		std::vector<std::uintmax_t> sizes(filelist.size());
+		for (size_t i = 0; i < filelist.size(); i++)
+		{
+			std::error_code ec;
+			auto size = std::filesystem::file_size(filelist[i], ec);
+			sizes[i] = ec ? 0 : size;
+		}
+		std::unique_ptr<Prefetcher> prefetcher{};
+		if (m_prefetch > 0 && filelist.size() > 1)
+			prefetcher = std::make_unique<Prefetcher>();
+		std::vector<std::uintmax_t> prefetched(filelist.size());
+		std::uintmax_t ahead{ 0 };		// bytes prefetched for the files following the current one
+		size_t next{ 1 };				// next file to prefetch
+		for (size_t i = 0; i < filelist.size(); i++)
+		{
+			ahead -= prefetched[i];
+			next = std::max(next, i + 1);
+			while (prefetcher && next < filelist.size() && next <= i + PREFETCH_DEPTH && ahead < m_prefetch)
+			{
+				prefetched[next] = std::min(sizes[next], m_prefetch - ahead);
+				prefetcher->prefetch(filelist[next], prefetched[next]);
+				ahead += prefetched[next++];
+			}
+			auto start = std::chrono::steady_clock::now();
+			ProcessFile(filelist[i], m_stats ? &m_run_stats.files[i] : nullptr);
+			stats.busy += std::chrono::steady_clock::now() - start;
+			stats.files++;
+			stats.bytes += sizes[i];
+		}
+	}
+	return static_cast<int>(filelist.size());
+}
+
+namespace
+{
+	thread_local File_Stats* current_file{ nullptr };		// statistics of the file processed by the thread
+
+	std::chrono::nanoseconds thread_cpu_time()
+	{
+#ifdef _WIN32
+		FILETIME creation, exit, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+			return std::chrono::nanoseconds(0);
+		ULARGE_INTEGER k, u;
+		k.LowPart = kernel.dwLowDateTime;
+		k.HighPart = kernel.dwHighDateTime;
+		u.LowPart = user.dwLowDateTime;
+		u.HighPart = user.dwHighDateTime;
+		return std::chrono::nanoseconds((k.QuadPart + u.QuadPart) * 100);		// FILETIME unit is 100 ns
+#else
+		timespec ts;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+			return std::chrono::nanoseconds(0);
+		return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+#endif // _WIN32
+	}
+}
+
+void ConsoleApp::AddRecords(size_t records)
+{
+	if (current_file != nullptr)
+		current_file->records += records;
+}
+
+void ConsoleApp::ProcessFile(const std::filesystem::path& file, File_Stats* stats)
+{
+	struct Current_File
+	{
+		Current_File(File_Stats* stats) { current_file = stats; }
+		~Current_File() { current_file = nullptr; }
+	} current(stats);
+	auto start = std::chrono::steady_clock::now();
+	auto cpu = stats != nullptr ? thread_cpu_time() : std::chrono::nanoseconds(0);
+	if (!m_mapped)
+		MainProcess(file);
+	else
+	{
+		MappedFile content(file);
+		MappedProcess(file, content.view());
+	}
+	if (stats != nullptr)
+	{
+		stats->cpu = thread_cpu_time() - cpu;
+		stats->wall = std::chrono::steady_clock::now() - start;
+		stats->file = file;
+		std::error_code ec;
+		auto size = std::filesystem::file_size(file, ec);
+		stats->bytes = ec ? 0 : size;
+	}
+}
+
+namespace
+{
+	// Files assigned to a worker, largest first. Idle workers steal files from the queue which has the most remaining bytes.
+	struct File_Queue
+	{
+		std::mutex mutex;
+		std::deque<size_t> files;				// indexes in the file list
+		std::atomic<std::uintmax_t> bytes{ 0 };	// size of the queued files
+	};
+}
+
+void ConsoleApp::ByFileParallel(const std::vector<std::filesystem::path>& filelist)
+{
+	constexpr size_t NO_FAILURE{ std::numeric_limits<size_t>::max() };
+	auto nbthreads = std::min(static_cast<size_t>(m_threads), filelist.size());
+	std::vector<std::uintmax_t> sizes(filelist.size(), 0);
+	std::vector<size_t> order(filelist.size());
+	for (size_t i = 0; i < filelist.size(); i++)
+	{
+		std::error_code ec;
+		auto size = std::filesystem::file_size(filelist[i], ec);
+		sizes[i] = ec ? 0 : size;
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+	// largest files are first assigned to the less loaded worker
+	std::vector<File_Queue> queues(nbthreads);
+	for (auto i : order)
+	{
+		auto q = std::min_element(queues.begin(), queues.end(),
+			[](const File_Queue& a, const File_Queue& b) { return a.bytes < b.bytes; });
+		q->files.push_back(i);
+		q->bytes += sizes[i];
+	}
+	auto take = [&](File_Queue& q, size_t& i)
+	{
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (q.files.empty())
+			return false;
+		i = q.files.front();
+		q.files.pop_front();
+		q.bytes -= sizes[i];
+		return true;
+	};
+	auto steal = [&](size_t& i)
+	{
+		// takes the next file of the busiest worker until all the queues are empty
+		while (true)
 		{
+			File_Queue* victim{ nullptr };
+			for (auto& q : queues)
+			{
+				std::lock_guard<std::mutex> lock(q.mutex);
+				if (!q.files.empty() && (victim == nullptr || q.bytes > victim->bytes))
+					victim = &q;
+			}
+			if (victim == nullptr)
+				return false;
+			if (take(*victim, i))
+				return true;
+		}
+	};
+
+	// After a failure, only the files preceding the first failing one in the list order are still processed.
+	// So the rethrown exception is the same than in serial mode.
+	std::vector<std::exception_ptr> errors(filelist.size());
+	std::atomic<size_t> firstfail{ NO_FAILURE };
+	auto worker = [&](size_t w)
+	{
+		auto& stats = m_workers_stats[w];
+		size_t i;
+		while (true)
+		{
+			bool stolen{ false };
+			if (!take(queues[w], i))
+			{
+				if (!steal(i))
+					break;
+				stolen = true;
+			}
+			if (i > firstfail)
+				continue;
+			auto start = std::chrono::steady_clock::now();
 			try {
-				MainProcess(file); }
+				ProcessFile(filelist[i], m_stats ? &m_run_stats.files[i] : nullptr); }
 			catch (...) {
-				throw; }
-			nbfiles++;
+				errors[i] = std::current_exception();
+				auto f = firstfail.load();
+				while (i < f && !firstfail.compare_exchange_weak(f, i)); }
+			stats.busy += std::chrono::steady_clock::now() - start;
+			stats.files++;
+			stats.bytes += sizes[i];
+			if (stolen)
+				stats.stolen++;
 		}
-	}
-	if (nbfiles == 0)
+	};
+	m_workers_stats.assign(nbthreads, Worker_Stats{});
+	std::vector<std::thread> pool{};
+	for (size_t w = 0; w < nbthreads; w++)
+		pool.emplace_back(worker, w);
+	for (auto& t : pool)
+		t.join();
+	if (firstfail != NO_FAILURE)
+		std::rethrow_exception(errors[firstfail]);
+}
+
+int ConsoleApp::ByFileStreaming(const std::vector<std::string>& patterns)
+{
+	constexpr size_t NO_FAILURE{ std::numeric_limits<size_t>::max() };
+	const size_t nbthreads{ m_threads };
+	// The patterns are scanned one after the other by a single thread for a reproducible order.
+	// The files are indexed in that order and, as in ByFileParallel, the rethrown exception is the one of the first failing file.
+	std::mutex mutex{};
+	size_t pattern{ 0 };
+	std::unique_ptr<Dir_Reader> reader{};
+	File_Set files_set{};			// a file matching several patterns is processed once
+	size_t count{ 0 };
+	std::deque<File_Stats> files_stats{};		// references are kept by push_back
+	size_t firstfail{ NO_FAILURE };
+	std::exception_ptr error{};
+	auto fail = [&](size_t i, std::exception_ptr e)
+	{
+		if (i < firstfail)
+		{
+			firstfail = i;
+			error = e;
+		}
+	};
+	auto next = [&](std::filesystem::path& file, size_t& i, File_Stats*& stats)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		try
+		{
+			while (firstfail == NO_FAILURE)
+			{
+				if (!reader)
+				{
+					if (pattern == patterns.size())
+						return false;
+					reader = std::make_unique<Dir_Reader>(patterns[pattern++]);
+				}
+				bool found{ false };
+				while ((found = reader->next(file)) && !files_set.insert(file));
+				if (found)
+				{
+					i = count++;
+					stats = m_stats ? &files_stats.emplace_back() : nullptr;
+					return true;
+				}
+				reader.reset();
+			}
+		}
+		catch (...) {
+			fail(count, std::current_exception()); }
+		return false;
+	};
+	auto worker = [&](size_t w)
+	{
+		auto& wstats = m_workers_stats[w];
+		std::filesystem::path file{};
+		size_t i;
+		File_Stats* stats;
+		while (next(file, i, stats))
+		{
+			auto start = std::chrono::steady_clock::now();
+			try {
+				ProcessFile(file, stats); }
+			catch (...) {
+				std::lock_guard<std::mutex> lock(mutex);
+				fail(i, std::current_exception()); }
+			wstats.busy += std::chrono::steady_clock::now() - start;
+			wstats.files++;
+			std::error_code ec;
+			auto size = std::filesystem::file_size(file, ec);
+			wstats.bytes += ec ? 0 : size;
+		}
+	};
+	m_workers_stats.assign(nbthreads, Worker_Stats{});
+	std::vector<std::thread> pool{};
+	for (size_t w = 1; w < nbthreads; w++)
+		pool.emplace_back(worker, w);
+	worker(0);
+	for (auto& t : pool)
+		t.join();
+	reader.reset();
+	if (m_stats)
+		m_run_stats.files.assign(files_stats.begin(), files_stats.end());
+	if (error)
+		std::rethrow_exception(error);
+	if (count == 0)
 		throw std::filesystem::filesystem_error("No matching file.", std::make_error_code(std::errc::no_such_file_or_directory));
-	return nbfiles;
+	return static_cast<int>(count);
+}
+
+namespace
+{
+	// Returns the offsets of the chunks of the file, the last one being the size of the file.
+	// Each offset except the first and the last one follows the EOL that is found after the nominal offset.
+	std::vector<std::uintmax_t> chunk_bounds(const std::filesystem::path& file, EOL eol, std::uintmax_t size, size_t count)
+	{
+		std::vector<std::uintmax_t> bounds{ 0 };
+		if (eol != EOL::Unknown && count > 1)
+		{
+			const char last{ EOL_str(eol).back() };		// CR+LF sequences end with LF
+			std::ifstream in(file, std::ios_base::binary | std::ios_base::in);
+			std::vector<char> buf(4096);
+			for (size_t k = 1; k < count; k++)
+			{
+				auto pos = std::max(size / count * k, bounds.back());
+				bool found{ false };
+				in.clear();
+				in.seekg(static_cast<std::streamoff>(pos));
+				while (!found && in.read(buf.data(), buf.size()).gcount() > 0)
+				{
+					auto end = buf.begin() + static_cast<std::ptrdiff_t>(in.gcount());
+					auto itr = std::find(buf.begin(), end, last);
+					found = itr != end;
+					pos += (found ? std::distance(buf.begin(), itr) + 1 : std::distance(buf.begin(), end));
+				}
+				if (!found || pos >= size)
+					break;				// the last chunk ends at the end of the file
+				if (pos > bounds.back())
+					bounds.push_back(pos);
+			}
+		}
+		bounds.push_back(size);
+		return bounds;
+	}
+}
+
+size_t ConsoleApp::ByChunks(const std::filesystem::path& file, std::ostream& out, std::uintmax_t chunksize)
+{
+	const std::uintmax_t MIN_CHUNK_SIZE{ 1 << 20 };
+	auto size = std::filesystem::file_size(file);
+	size_t count{ 1 };
+	if (chunksize == 0)
+		count = static_cast<size_t>(std::min(size / MIN_CHUNK_SIZE, static_cast<std::uintmax_t>(m_threads) * 4));
+	else
+		count = static_cast<size_t>(size / chunksize);
+	auto bounds = chunk_bounds(file, file_EOL(file), size, std::max(count, static_cast<size_t>(1)));
+	auto nbchunks = bounds.size() - 1;
+
+	std::vector<std::string> outputs(nbchunks);
+	std::vector<std::exception_ptr> errors(nbchunks);
+	std::vector<bool> ready(nbchunks, false);
+	std::mutex mutex;
+	std::condition_variable done;
+	std::atomic<size_t> next{ 0 };
+	std::atomic<bool> failed{ false };
+	// the records added by ProcessChunk are counted by each worker and charged to the file of the calling thread after the join
+	auto stats = current_file;
+	auto nbthreads = std::min(static_cast<size_t>(m_threads), nbchunks);
+	std::vector<File_Stats> workers_files(nbthreads);
+	auto worker = [&](size_t w)
+	{
+		current_file = stats != nullptr ? &workers_files[w] : nullptr;
+		std::ifstream in(file, std::ios_base::binary | std::ios_base::in);
+		std::string chunk{};
+		while (!failed)
+		{
+			auto k = next++;
+			if (k >= nbchunks)
+				break;
+			std::string output{};
+			try
+			{
+				chunk.resize(static_cast<size_t>(bounds[k + 1] - bounds[k]));
+				in.seekg(static_cast<std::streamoff>(bounds[k]));
+				if (!in.read(&chunk[0], chunk.size()))
+					throw std::filesystem::filesystem_error("Unable to read chunk.", file, std::make_error_code(std::errc::io_error));
+				ProcessChunk(chunk, output);
+			}
+			catch (...)
+			{
+				errors[k] = std::current_exception();
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			outputs[k] = std::move(output);
+			ready[k] = true;
+			done.notify_one();
+		}
+		current_file = nullptr;
+	};
+	std::vector<std::thread> pool{};
+	for (size_t i = 0; i < nbthreads; i++)
+		pool.emplace_back(worker, i);
+	// outputs are written in order by the calling thread while the next chunks are processed
+	std::exception_ptr error{};
+	for (size_t k = 0; k < nbchunks && !error; k++)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&]() { return ready[k]; });
+		if (errors[k])
+		{
+			error = errors[k];
+			failed = true;
+			break;
+		}
+		auto output = std::move(outputs[k]);
+		lock.unlock();
+		out.write(output.data(), static_cast<std::streamsize>(output.size()));
+	}
+	for (auto& t : pool)
+		t.join();
+	for (auto& w : workers_files)
+		AddRecords(w.records);
+	if (error)
+		std::rethrow_exception(error);
+	return nbchunks;
+}
+
+namespace
+{
+	// Bounded lock-free queue between a single producer thread and a single consumer thread
+	template <class T>
+	class SPSC_Queue
+	{
+	public:
+		SPSC_Queue(size_t capacity) : m_items(capacity + 1) {}
+
+		bool try_push(const T& item)
+		{
+			auto tail = m_tail.load(std::memory_order_relaxed);
+			auto next = (tail + 1) % m_items.size();
+			if (next == m_head.load(std::memory_order_acquire))
+				return false;
+			m_items[tail] = item;
+			m_tail.store(next, std::memory_order_release);
+			return true;
+		}
+
+		bool try_pop(T& item)
+		{
+			auto head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tail.load(std::memory_order_acquire))
+				return false;
+			item = m_items[head];
+			m_head.store((head + 1) % m_items.size(), std::memory_order_release);
+			return true;
+		}
+
+		// blocking push and pop: they spin shortly, then sleep until the other side makes progress or cancel is set by a failed stage
+		bool push(const T& item, const std::atomic<bool>& cancel, bool& waited) { return wait([&]() { return try_push(item); }, cancel, waited); }
+		bool pop(T& item, const std::atomic<bool>& cancel, bool& waited) { return wait([&]() { return try_pop(item); }, cancel, waited); }
+		// wakes the sleeping side after cancel is set
+		void wake()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_cv.notify_all();
+		}
+
+		size_t capacity() const noexcept { return m_items.size() - 1; }
+		size_t size() const noexcept
+		{
+			auto head = m_head.load(std::memory_order_acquire);
+			auto tail = m_tail.load(std::memory_order_acquire);
+			return (tail + m_items.size() - head) % m_items.size();
+		}
+
+	private:
+		static const int SPIN_COUNT{ 64 };
+
+		std::vector<T> m_items;
+		alignas(64) std::atomic<size_t> m_head{ 0 };
+		alignas(64) std::atomic<size_t> m_tail{ 0 };
+		alignas(64) std::atomic<int> m_waiters{ 0 };
+		std::mutex m_mutex{};
+		std::condition_variable m_cv{};
+
+		template <class Attempt>
+		bool wait(Attempt attempt, const std::atomic<bool>& cancel, bool& waited)
+		{
+			waited = false;
+			for (int i = 0; i < SPIN_COUNT; i++)
+			{
+				if (attempt())
+				{
+					notify();
+					return true;
+				}
+				if (cancel)
+					return false;
+				waited = true;
+				std::this_thread::yield();
+			}
+			bool done{ false };
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_waiters.fetch_add(1);
+			// pairs with the fence of notify: either the other side sees the waiter or the attempt sees its progress
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			m_cv.wait(lock, [&]() { return (done = attempt()) || cancel; });
+			m_waiters.fetch_sub(1);
+			lock.unlock();
+			if (done)
+				notify();
+			return done;
+		}
+		void notify()
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_waiters.load(std::memory_order_relaxed) > 0)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_cv.notify_all();
+			}
+		}
+	};
+
+	// A block of records exchanged between the stages of the pipeline
+	struct Record_Batch
+	{
+		std::unique_ptr<char[]> data{};			// uninitialized, so the blocks are read in it without clearing it before
+		size_t capacity{ 0 };
+		size_t size{ 0 };
+		std::vector<std::pair<std::string_view, std::string_view>> records{};		// records and their EOL
+		std::string output{};
+	};
+}
+
+size_t ConsoleApp::ByPipeline(const std::filesystem::path& input, const std::filesystem::path& output, Pipeline_Stats* stats)
+{
+	const size_t BATCH_SIZE{ 1 << 20 };
+	const size_t QUEUE_CAPACITY{ 4 };
+	const size_t NB_BATCHES{ 3 * QUEUE_CAPACITY + 2 };
+	auto eol_type = file_EOL(input);
+	const char last{ eol_type == EOL::Mac ? '\r' : '\n' };		// CR+LF sequences end with LF
+	Block_Reader in(input, m_io_backend, BATCH_SIZE);
+	OutputWriter writer(output);
+
+	// the batches go round from the read stage to the write stage and back through the recycle queue, so memory is bounded
+	std::vector<Record_Batch> batches(NB_BATCHES);
+	SPSC_Queue<Record_Batch*> recycle(NB_BATCHES);
+	for (auto& batch : batches)
+		recycle.try_push(&batch);
+	std::array<SPSC_Queue<Record_Batch*>, 3> queues{ SPSC_Queue<Record_Batch*>(QUEUE_CAPACITY), SPSC_Queue<Record_Batch*>(QUEUE_CAPACITY), SPSC_Queue<Record_Batch*>(QUEUE_CAPACITY) };
+	Pipeline_Stats local{};
+	std::atomic<bool> failed{ false };
+	std::array<std::exception_ptr, 4> errors{};
+
+	// a null batch marks the end of the input, push and pop return false if another stage failed
+	auto push = [&](SPSC_Queue<Record_Batch*>& q, Queue_Stats* qs, Record_Batch* batch)
+	{
+		if (qs != nullptr)
+		{
+			auto size = q.size();
+			qs->pushes++;
+			qs->occupancy += size;
+			qs->maximum = std::max(qs->maximum, size);
+		}
+		bool waited{ false };
+		if (!q.push(batch, failed, waited))
+			return false;
+		if (waited && qs != nullptr)
+			qs->full++;
+		return true;
+	};
+	auto pop = [&](SPSC_Queue<Record_Batch*>& q, Queue_Stats* qs, Record_Batch*& batch)
+	{
+		bool waited{ false };
+		if (!q.pop(batch, failed, waited))
+			return false;
+		if (waited && qs != nullptr)
+			qs->empty++;
+		return true;
+	};
+	auto stage = [&](size_t index, auto body)
+	{
+		try {
+			body(); }
+		catch (...) {
+			errors[index] = std::current_exception();
+			failed = true;
+			recycle.wake();
+			for (auto& q : queues)
+				q.wake(); }
+	};
+
+	std::thread reader([&]()
+	{
+		stage(0, [&]()
+		{
+			// the batch grows geometrically, keeping the bytes already read, so a long record is not copied again for each block
+			auto grow = [](Record_Batch* batch, size_t needed)
+			{
+				if (batch->capacity >= needed)
+					return;
+				auto capacity = std::max(2 * batch->capacity, needed);
+				std::unique_ptr<char[]> data(new char[capacity]);
+				if (batch->size != 0)
+					std::memcpy(data.get(), batch->data.get(), batch->size);
+				batch->data = std::move(data);
+				batch->capacity = capacity;
+			};
+			std::string carry{};
+			Record_Batch* batch{ nullptr };
+			bool more{ true };
+			while (more)
+			{
+				if (batch == nullptr)
+				{
+					if (!pop(recycle, nullptr, batch))
+						return;
+					batch->size = 0;
+					grow(batch, carry.size() + in.blocksize());
+					std::memcpy(batch->data.get(), carry.data(), carry.size());
+					batch->size = carry.size();
+					carry.clear();
+				}
+				else
+					grow(batch, batch->size + in.blocksize());
+				char* data = batch->data.get();
+				auto got = in.read(data + batch->size);
+				more = got > 0;
+				auto scanned = batch->size;		// the bytes before hold no EOL, they are the incomplete record carried or kept
+				batch->size += got;
+				if (batch->size == 0)
+					break;			// the unused batch is not recycled, the writer being the only producer of the recycle queue
+				if (more)
+				{
+					// a record longer than the batch is kept whole, the batch grows until its EOL or the end of file
+					auto end = std::string_view(data + scanned, got).rfind(last);
+					if (end == std::string_view::npos)
+						continue;
+					// the incomplete record at end of the batch is carried to the next one
+					carry.assign(data + scanned + end + 1, data + batch->size);
+					batch->size = scanned + end + 1;
+				}
+				if (!push(queues[0], &local.queues[0], batch))
+					return;
+				batch = nullptr;
+			}
+			push(queues[0], nullptr, nullptr);
+		});
+	});
+	std::thread parser([&]()
+	{
+		stage(1, [&]()
+		{
+			Record_Batch* batch;
+			while (pop(queues[0], &local.queues[0], batch) && batch != nullptr)
+			{
+				batch->records.clear();
+				const char* p = batch->data.get();
+				const char* end = p + batch->size;
+				while (p != end)
+				{
+					auto found = static_cast<const char*>(std::memchr(p, last, end - p));
+					auto next = found == nullptr ? end : found + 1;
+					auto rec = found == nullptr ? end : found;
+					if (eol_type == EOL::Windows && rec != p && rec != end && rec[-1] == '\r')
+						rec--;
+					batch->records.emplace_back(std::string_view(p, rec - p), std::string_view(rec, next - rec));
+					p = next;
+				}
+				if (!push(queues[1], &local.queues[1], batch))
+					return;
+			}
+			if (!failed)
+				push(queues[1], nullptr, nullptr);
+		});
+	});
+	std::thread writing([&]()
+	{
+		stage(3, [&]()
+		{
+			Record_Batch* batch;
+			while (pop(queues[2], &local.queues[2], batch) && batch != nullptr)
+			{
+				writer.write(batch->output);
+				if (!push(recycle, nullptr, batch))
+					return;
+			}
+			if (!failed)
+				writer.close();
+		});
+	});
+	stage(2, [&]()
+	{
+		Record_Batch* batch;
+		while (pop(queues[1], &local.queues[1], batch) && batch != nullptr)
+		{
+			batch->output.clear();
+			for (auto& rec : batch->records)
+				TransformRecord(rec.first, rec.second, batch->output);
+			local.records += batch->records.size();
+			local.batches++;
+			if (!push(queues[2], &local.queues[2], batch))
+				return;
+		}
+		if (!failed)
+			push(queues[2], nullptr, nullptr);
+	});
+	reader.join();
+	parser.join();
+	writing.join();
+	for (auto& e : errors)
+		if (e)
+			std::rethrow_exception(e);
+	for (size_t i = 0; i < queues.size(); i++)
+		local.queues[i].capacity = queues[i].capacity();
+	if (stats != nullptr)
+		*stats = local;
+	AddRecords(local.records);
+	return local.records;
 }
 
 std::filesystem::path ConsoleApp::getOutPath(const std::filesystem::path& inpath)
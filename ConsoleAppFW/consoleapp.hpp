@@ -7,10 +7,79 @@
 *   \author Christophe COUAILLET
 */
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <iosfwd>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "../usage/usage.hpp"
+#include "../utils/utils.hpp"
+
+/*! \brief Statistics of a worker that calls the function MainProcess.
+*	\sa ConsoleApp::workers_stats()
+*/
+struct Worker_Stats
+{
+	size_t files{ 0 };							// number of files processed by the worker
+	size_t stolen{ 0 };							// number of files taken from the queue of another worker
+	std::uintmax_t bytes{ 0 };					// total size of the files processed
+	std::chrono::nanoseconds busy{ 0 };			// time spent in MainProcess
+};
+
+/*! \brief Statistics of the processing of a file.
+*	\sa ConsoleApp::run_stats()
+*/
+struct File_Stats
+{
+	std::filesystem::path file{};				// processed file
+	std::uintmax_t bytes{ 0 };					// size of the file
+	size_t records{ 0 };						// number of records reported by the application with ConsoleApp::AddRecords
+	std::chrono::nanoseconds wall{ 0 };			// elapsed time of the processing of the file
+	std::chrono::nanoseconds cpu{ 0 };			// CPU time of the thread that processed the file
+};
+
+/*! \brief Statistics of the function ConsoleApp::Run.
+*	\sa ConsoleApp::run_stats()
+*/
+struct Run_Stats
+{
+	std::vector<File_Stats> files{};			// statistics of each processed file in the list order
+	std::uintmax_t bytes{ 0 };					// total size of the processed files
+	size_t records{ 0 };						// total number of records
+	std::chrono::nanoseconds wall{ 0 };			// elapsed time of the function Run, including PreProcess and PostProcess
+	std::chrono::nanoseconds cpu{ 0 };			// total CPU time of the processing of the files
+	std::chrono::nanoseconds p50{ 0 };			// median of the elapsed times of the files
+	std::chrono::nanoseconds p99{ 0 };			// 99th percentile of the elapsed times of the files
+};
+
+/*! \brief Occupancy of a queue between two stages of the function ConsoleApp::ByPipeline.
+*
+*	A queue that is often full shows that its consumer stage is the bottleneck, a queue that is often empty shows that its producer stage is.
+*/
+struct Queue_Stats
+{
+	size_t capacity{ 0 };						// maximum number of batches in the queue
+	size_t pushes{ 0 };							// number of batches pushed
+	size_t occupancy{ 0 };						// sum of the number of batches found in the queue at each push
+	size_t maximum{ 0 };						// maximum number of batches found in the queue at a push
+	size_t full{ 0 };							// number of pushes that waited for a free slot
+	size_t empty{ 0 };							// number of pops that waited for a batch
+
+	/*! \brief Returns the average number of batches found in the queue at each push. */
+	double average() const { return pushes == 0 ? 0.0 : static_cast<double>(occupancy) / pushes; }
+};
+
+/*! \brief Statistics of the function ConsoleApp::ByPipeline. */
+struct Pipeline_Stats
+{
+	size_t records{ 0 };						// number of records transformed
+	size_t batches{ 0 };						// number of batches of records
+	std::array<Queue_Stats, 3> queues{};		// queues read -> parse, parse -> transform and transform -> write
+};
 
 /*! \brief An abstract class that implements a framework for console applications that process files.
 
@@ -70,8 +139,74 @@ public:
 	*	An assertion occurs if the function Arguments has not been called first.
 	*	This function should not be called if the return of the function Arguments was not an empty string.
 	*	\throws A "No matching file" exception is thrown if the argument 'file' is defined but no files matching passed values are found.
+	*	If MainProcess throws while running in parallel mode, the exception of the first failing file in the list order is rethrown once all the workers are stopped.
 	*/
 	int Run();															// Runs the sequence PreProcess, ByFile and PostProcess and returns the number of files processed
+	/*! \brief Returns the number of threads used to call MainProcess.
+	*
+	*	The default value 1 means that files are processed serially.
+	*/
+	unsigned int threads() const { return m_threads; }
+	/*! \brief Sets the number of threads used to call MainProcess. The value 0 means one thread per available core.
+	*
+	*	If more than one thread is used, the files are dispatched to a pool of workers and the overriden function MainProcess must be thread safe.
+	*	PreProcess and PostProcess are still called once by the calling thread.
+	*	\sa ConsoleApp::AddThreadsArgument()
+	*/
+	void set_threads(unsigned int threads);
+	/*! \brief Returns the statistics of each worker for the last call of the function Run.
+	*
+	*	In parallel mode, the files are sorted by decreasing size and assigned to the less loaded worker, then idle workers steal the queued files of the busiest ones.
+	*	The busy time of each worker shows how well the load was balanced. In serial mode, the list contains a single worker.
+	*/
+	const std::vector<Worker_Stats>& workers_stats() const { return m_workers_stats; }
+	/*! \brief Returns true if the statistics of the files are collected by the function Run. */
+	bool statistics() const { return m_stats; }
+	/*! \brief Sets the collection of the statistics of the files. It is false by default.
+	*	\sa ConsoleApp::AddStatsArgument()
+	*/
+	void set_statistics(bool stats) { m_stats = stats; }
+	/*! \brief Returns the statistics of the last call of the function Run if their collection is enabled.
+	*
+	*	For each file, the statistics include its size, the number of records reported with AddRecords, the elapsed time and the CPU time of its processing.
+	*	The run totals include the median and the 99th percentile of the elapsed time per file.
+	*/
+	const Run_Stats& run_stats() const { return m_run_stats; }
+	/*! \brief Returns true if the files are mapped in memory and passed to MappedProcess instead of MainProcess. */
+	bool mapped_input() const { return m_mapped; }
+	/*! \brief Sets the mapped input mode. It is false by default.
+	*
+	*	In this mode, each file is mapped in memory with a MappedFile object and its whole content is passed to the overriden function MappedProcess.
+	*	\sa MappedFile
+	*/
+	void set_mapped_input(bool mapped) { m_mapped = mapped; }
+	/*! \brief Returns true if the files are processed as they are discovered. */
+	bool streaming() const { return m_streaming; }
+	/*! \brief Sets the streaming mode. It is false by default.
+	*
+	*	In this mode, the files matching the argument 'file' values are enumerated by a Dir_Reader object and each one is processed as soon as it is found,
+	*	instead of after the enumeration of all the patterns. The files are processed in the discovery order and the workers take the next file when they are idle,
+	*	so the files are not balanced by size.
+	*	\sa Dir_Reader
+	*/
+	void set_streaming(bool streaming) { m_streaming = streaming; }
+	/*! \brief Returns the byte budget of the prefetch of the next files, 0 if disabled. */
+	std::uintmax_t prefetch_budget() const { return m_prefetch; }
+	/*! \brief Sets the byte budget of the prefetch of the next files. It is 0 (disabled) by default.
+	*
+	*	In serial mode, while a file is processed, the next two files of the list are loaded in the system cache by a Prefetcher object,
+	*	up to the given number of bytes ahead of the current file. It has no effect in parallel and streaming modes.
+	*	\sa Prefetcher
+	*/
+	void set_prefetch_budget(std::uintmax_t bytes) { m_prefetch = bytes; }
+	/*! \brief Returns the backend used by ByPipeline to read the input file. */
+	IO_Backend io_backend() const { return m_io_backend; }
+	/*! \brief Sets the backend used by ByPipeline to read the input file. It is IO_Backend::Sync by default.
+	*
+	*	The IO_Backend::Uring backend keeps several reads in flight with io_uring on Linux and falls back to IO_Backend::Sync where it is not supported.
+	*	\sa Block_Reader
+	*/
+	void set_io_backend(IO_Backend backend) { m_io_backend = backend; }
 
 protected:
 	/*! \brief Implements an Usage object to handle arguments.
@@ -96,6 +231,27 @@ protected:
 	virtual void PreProcess() {};										// Launched before ByFile, do nothing by default
 	/*! \brief This function should be overriden to process each file matching the argument 'file' values. */
 	virtual void MainProcess(const std::filesystem::path& file) {};		// Launched by ByFile for each file matching argument 'file' values
+	/*! \brief This function should be overriden to process each file matching the argument 'file' values in mapped input mode.
+	*
+	*	The content is a read-only view of the whole file mapped in memory, it is valid until the function returns.
+	*	\sa ConsoleApp::set_mapped_input()
+	*/
+	virtual void MappedProcess(const std::filesystem::path& /*file*/, std::string_view /*content*/) {};
+																		// Launched by ByFile instead of MainProcess in mapped input mode
+	/*! \brief This function should be overriden to process a chunk of records when the function ByChunks is used.
+	*
+	*	The chunk contains whole records including their EOL. The result must be appended to output, it is written by ByChunks in the original order of the chunks.
+	*	\warning This function is called simultaneously by several threads, it must be thread safe.
+	*/
+	virtual void ProcessChunk(std::string_view /*chunk*/, std::string& /*output*/) {};
+																		// Launched by ByChunks for each chunk of a file
+	/*! \brief This function should be overriden to transform each record when the function ByPipeline is used.
+	*
+	*	The record is passed without its EOL, which is passed separately (it is empty for a last record without EOL).
+	*	The transformed record must be appended to output with an EOL if needed, so records can be dropped or split.
+	*/
+	virtual void TransformRecord(std::string_view /*record*/, std::string_view /*eol*/, std::string& /*output*/) {};
+																		// Launched by ByPipeline for each record of a file
 	/*! \brief This function should be overriden to perform global ending actions.
 	* 
 	*	In example, closing the global files that were open by the function PreProcess.
@@ -107,12 +263,66 @@ protected:
 	*	It returns the name of the inPath file with the last extension replaced by the value of the extension argument.
 	*	\warning If the extension argument does not exist or the arguments were not checked before then the returned path
 	*	points to the same file as inPath.
+	*	\sa OutputWriter to write the output file by large blocks.
 	*/
 	std::filesystem::path getOutPath(const std::filesystem::path & inPath);
+	/*! \brief Adds the standard optional argument /threads:N to the Usage object.
+	*
+	*	This function should be called by the overriden function SetUsage if the application supports the parallel processing of files.
+	*	The value passed through the command line is applied by the function Arguments before launching CheckArguments.
+	*	\sa ConsoleApp::set_threads()
+	*/
+	void AddThreadsArgument();
+	/*! \brief Adds the standard optional argument /stats to the Usage object.
+	*
+	*	This function should be called by the overriden function SetUsage. If the argument is passed, the function Arguments enables the collection of statistics.
+	*	\sa ConsoleApp::set_statistics()
+	*/
+	void AddStatsArgument();
+	/*! \brief Adds the given number of records to the statistics of the file being processed by the calling thread.
+	*
+	*	This function should be called by the overriden functions MainProcess, MappedProcess or ProcessChunk. It does nothing if the statistics are not collected.
+	*	The function ByPipeline calls it for the records it transforms.
+	*/
+	void AddRecords(size_t records);
+	/*! \brief Splits the given file into chunks of records and calls ProcessChunk for each of them on threads() threads.
+	*
+	*	This function is provided to process a single large file in parallel. It should be called by the overriden function MainProcess.
+	*	The byte ranges of the chunks are aligned on the EOL detected by the function file_EOL, so a record is never split between two chunks.
+	*	The outputs of the chunks are written to out in the original order as soon as they are available.
+	*	The function returns the number of chunks. If the EOL is unknown, the whole file is processed as a single chunk.
+	*	\param chunksize The nominal size of the chunks. If 0, the file is split into 4 chunks per thread of at least 1 MB.
+	*	\throws If ProcessChunk throws, the exception of the first failing chunk is rethrown once all the threads are stopped.
+	*/
+	size_t ByChunks(const std::filesystem::path& file, std::ostream& out, std::uintmax_t chunksize = 0);
+	/*! \brief Transforms the records of the input file into the output file with a pipeline of four stages and returns the number of records.
+	*
+	*	This function is provided to overlap reading, parsing and writing with the transformation of records. It should be called by the overriden function MainProcess.
+	*	Reading the blocks of records, splitting them on the EOL detected by the function file_EOL and writing the output with an OutputWriter object
+	*	are each done by a separate thread, while the calling thread calls TransformRecord. The stages exchange batches of records through bounded lock-free queues.
+	*	A stage that waits on a full or empty queue spins shortly, then sleeps until the queue changes, so a stage waiting on I/O uses no CPU.
+	*	\param stats If not null, receives the occupancy of the queues to find the bottleneck stage.
+	*	\throws If a stage throws, all the stages are stopped and the exception of the first stage in the pipeline order is rethrown.
+	*/
+	size_t ByPipeline(const std::filesystem::path& input, const std::filesystem::path& output, Pipeline_Stats* stats = nullptr);
 
 private:
 	bool m_argschecked{ false };
 	bool m_windowsmode{ false };
+	unsigned int m_threads{ 1 };
+	bool m_mapped{ false };
+	bool m_stats{ false };
+	bool m_streaming{ false };
+	std::uintmax_t m_prefetch{ 0 };
+	IO_Backend m_io_backend{ IO_Backend::Sync };
+	Run_Stats m_run_stats{};
+	std::vector<Worker_Stats> m_workers_stats{};
 
+	std::string StandardArguments();									// Applies the values of the standard arguments and returns an error message if one is wrong
 	int ByFile();														// Calls MainProcess for each file matching argument 'file' values and returns the number of files processed
+	void ProcessFile(const std::filesystem::path& file, File_Stats* stats);
+																		// Calls MainProcess or MappedProcess depending on the input mode and collects the statistics
+	void ByFileParallel(const std::vector<std::filesystem::path>& filelist);
+																		// Dispatches the calls of MainProcess to a pool of workers
+	int ByFileStreaming(const std::vector<std::string>& patterns);	// Processes the files as they are discovered and returns their number
 };
\ No newline at end of file
@@ -91,6 +91,457 @@ TEST_F(MyAppTest, Run_Test)
 	EXPECT_EQ(cons1.Run(), 2);
 }
 
+namespace fs = std::filesystem;
+
+class CountingApp : public ConsoleApp
+{
+public:
+	std::atomic<int> processed{ 0 };
+	int preprocessed{ 0 };
+	int postprocessed{ 0 };
+	std::string failfrom{};			// files which name is greater or equal than failfrom throw an exception
+	std::atomic<size_t> bytes{ 0 };
+
+protected:
+	virtual void SetUsage() override
+	{
+		Unnamed_Arg f{ "file" };
+		f.set_required(true);
+		f.many = true;
+		us.add_Argument(f);
+		AddThreadsArgument();
+		AddStatsArgument();
+	}
+	virtual void PreProcess() override { preprocessed++; }
+	virtual void MainProcess(const fs::path& file) override
+	{
+		auto name = file.filename().string();
+		if (!failfrom.empty() && name >= failfrom)
+			throw std::runtime_error(name);
+		AddRecords(1);
+		processed++;
+	}
+	virtual void MappedProcess(const fs::path& file, std::string_view content) override
+	{
+		bytes += content.size();
+		processed++;
+	}
+	virtual void PostProcess() override { postprocessed++; }
+};
+
+class ParallelTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		m_dir = fs::temp_directory_path() / "consoleapp_parallel_test";
+		fs::create_directories(m_dir);
+		for (int i = 0; i < 20; i++)
+			std::ofstream(m_dir / ("file" + std::to_string(10 + i) + ".txt")) << "line " << i << std::endl;
+		m_cwd = fs::current_path();
+		fs::current_path(m_dir);
+	}
+
+	void TearDown() override
+	{
+		fs::current_path(m_cwd);
+		fs::remove_all(m_dir);
+	}
+
+	fs::path m_cwd;
+	fs::path m_dir;
+	std::string m_pattern{ "file*.txt" };
+};
+
+TEST_F(ParallelTest, Invalid_Threads_Argument)
+{
+	CountingApp app;
+	std::vector<char*> argv{ "program.exe", &m_pattern[0], "/threads:many" };
+	EXPECT_STRNE(app.Arguments((int)argv.size(), &argv[0]).c_str(), "");
+}
+
+TEST_F(ParallelTest, Default_Is_Serial)
+{
+	CountingApp app;
+	std::vector<char*> argv{ "program.exe", &m_pattern[0] };
+	EXPECT_STREQ(app.Arguments((int)argv.size(), &argv[0]).c_str(), "");
+	EXPECT_EQ(app.threads(), 1);
+	EXPECT_EQ(app.Run(), 20);
+	EXPECT_EQ(app.processed, 20);
+}
+
+TEST_F(ParallelTest, Run_With_Threads)
+{
+	CountingApp app;
+	std::vector<char*> argv{ "program.exe", &m_pattern[0], "/threads:4" };
+	EXPECT_STREQ(app.Arguments((int)argv.size(), &argv[0]).c_str(), "");
+	EXPECT_EQ(app.threads(), 4);
+	EXPECT_EQ(app.Run(), 20);
+	EXPECT_EQ(app.processed, 20);
+	EXPECT_EQ(app.preprocessed, 1);
+	EXPECT_EQ(app.postprocessed, 1);
+}
+
+TEST_F(ParallelTest, Workers_Stats)
+{
+	CountingApp app;
+	std::vector<char*> argv{ "program.exe", &m_pattern[0], "/threads:3" };
+	app.Arguments((int)argv.size(), &argv[0]);
+	EXPECT_EQ(app.Run(), 20);
+	auto stats = app.workers_stats();
+	EXPECT_EQ(stats.size(), 3);
+	size_t files{ 0 };
+	std::uintmax_t bytes{ 0 };
+	for (auto& w : stats)
+	{
+		files += w.files;
+		bytes += w.bytes;
+	}
+	std::uintmax_t expected{ 0 };
+	for (auto& entry : fs::directory_iterator(m_dir))
+		expected += entry.file_size();
+	EXPECT_EQ(files, 20);
+	EXPECT_EQ(bytes, expected);
+}
+
+TEST_F(ParallelTest, Run_Stats)
+{
+	for (auto threads : { "/threads:1", "/threads:4" })
+	{
+		CountingApp app;
+		std::vector<char*> argv{ "program.exe", &m_pattern[0], const_cast<char*>(threads), "/stats" };
+		EXPECT_STREQ(app.Arguments((int)argv.size(), &argv[0]).c_str(), "");
+		EXPECT_TRUE(app.statistics());
+		EXPECT_EQ(app.Run(), 20);
+		auto& stats = app.run_stats();
+		EXPECT_EQ(stats.files.size(), 20);
+		std::uintmax_t expected{ 0 };
+		for (auto& entry : fs::directory_iterator(m_dir))
+			expected += entry.file_size();
+		EXPECT_EQ(stats.bytes, expected);
+		EXPECT_EQ(stats.records, 20);
+		for (auto& f : stats.files)
+		{
+			EXPECT_EQ(f.records, 1);
+			EXPECT_EQ(f.bytes, fs::file_size(f.file));
+		}
+		EXPECT_LE(stats.p50, stats.p99);
+		EXPECT_GE(stats.wall, stats.p99);
+	}
+}
+
+TEST_F(ParallelTest, No_Stats_By_Default)
+{
+	CountingApp app;
+	std::vector<char*> argv{ "program.exe", &m_pattern[0] };
+	app.Arguments((int)argv.size(), &argv[0]);
+	EXPECT_FALSE(app.statistics());
+	EXPECT_EQ(app.Run(), 20);
+	EXPECT_TRUE(app.run_stats().files.empty());
+}
+
+TEST_F(ParallelTest, Mapped_Input)
+{
+	CountingApp app;
+	std::vector<char*> argv{ "program.exe", &m_pattern[0], "/threads:2" };
+	app.Arguments((int)argv.size(), &argv[0]);
+	app.set_mapped_input(true);
+	EXPECT_EQ(app.Run(), 20);
+	EXPECT_EQ(app.processed, 20);
+	std::uintmax_t expected{ 0 };
+	for (auto& entry : fs::directory_iterator(m_dir))
+		expected += entry.file_size();
+	EXPECT_EQ(app.bytes, expected);
+}
+
+TEST_F(ParallelTest, Exception_Is_Deterministic)
+{
+	CountingApp serial, parallel;
+	std::vector<char*> argv1{ "program.exe", &m_pattern[0] };
+	std::vector<char*> argv2{ "program.exe", &m_pattern[0], "/threads:8" };
+	serial.Arguments((int)argv1.size(), &argv1[0]);
+	parallel.Arguments((int)argv2.size(), &argv2[0]);
+	serial.failfrom = parallel.failfrom = "file20";
+	std::string msg1, msg2;
+	try { serial.Run(); }
+	catch (const std::runtime_error& e) { msg1 = e.what(); }
+	try { parallel.Run(); }
+	catch (const std::runtime_error& e) { msg2 = e.what(); }
+	EXPECT_FALSE(msg1.empty());
+	EXPECT_EQ(msg1, msg2);
+	EXPECT_EQ(parallel.postprocessed, 0);
+}
+
+TEST_F(ParallelTest, Streaming)
+{
+	for (auto threads : { "/threads:1", "/threads:4" })
+	{
+		CountingApp app;
+		std::vector<char*> argv{ "program.exe", &m_pattern[0], const_cast<char*>(threads), "/stats" };
+		app.Arguments((int)argv.size(), &argv[0]);
+		app.set_streaming(true);
+		EXPECT_EQ(app.Run(), 20);
+		EXPECT_EQ(app.processed, 20);
+		EXPECT_EQ(app.run_stats().files.size(), 20);
+		EXPECT_EQ(app.run_stats().records, 20);
+	}
+}
+
+TEST_F(ParallelTest, Streaming_Exception_Is_Deterministic)
+{
+	CountingApp serial, parallel;
+	std::vector<char*> argv1{ "program.exe", &m_pattern[0] };
+	std::vector<char*> argv2{ "program.exe", &m_pattern[0], "/threads:8" };
+	serial.Arguments((int)argv1.size(), &argv1[0]);
+	parallel.Arguments((int)argv2.size(), &argv2[0]);
+	serial.set_streaming(true);
+	parallel.set_streaming(true);
+	serial.failfrom = parallel.failfrom = "file20";
+	std::string msg1, msg2;
+	try { serial.Run(); }
+	catch (const std::runtime_error& e) { msg1 = e.what(); }
+	try { parallel.Run(); }
+	catch (const std::runtime_error& e) { msg2 = e.what(); }
+	EXPECT_FALSE(msg1.empty());
+	EXPECT_EQ(msg1, msg2);
+}
+
+TEST_F(ParallelTest, Streaming_No_Matching_File)
+{
+	CountingApp app;
+	std::string pattern{ "none*.txt" };
+	std::vector<char*> argv{ "program.exe", &pattern[0] };
+	app.Arguments((int)argv.size(), &argv[0]);
+	app.set_streaming(true);
+	EXPECT_THROW(app.Run(), std::filesystem::filesystem_error);
+}
+
+TEST_F(ParallelTest, Overlapping_Patterns)
+{
+	std::string overlap{ "file1*.txt" };
+	std::string spelling{ "./file29.txt" };
+	for (bool streaming : { false, true })
+	{
+		CountingApp app;
+		std::vector<char*> argv{ "program.exe", &m_pattern[0], &overlap[0], &spelling[0], "/threads:4" };
+		app.Arguments((int)argv.size(), &argv[0]);
+		app.set_streaming(streaming);
+		EXPECT_EQ(app.Run(), 20);
+		EXPECT_EQ(app.processed, 20);
+	}
+}
+
+TEST_F(ParallelTest, Prefetch)
+{
+	CountingApp app;
+	std::vector<char*> argv{ "program.exe", &m_pattern[0] };
+	app.Arguments((int)argv.size(), &argv[0]);
+	app.set_prefetch_budget(16);
+	EXPECT_EQ(app.Run(), 20);
+	EXPECT_EQ(app.processed, 20);
+}
+
+class ChunkApp : public ConsoleApp
+{
+public:
+	using ConsoleApp::ByChunks;
+
+protected:
+	virtual void SetUsage() override {}
+	virtual void ProcessChunk(std::string_view chunk, std::string& output) override
+	{
+		if (chunk.empty() || chunk.back() != '\n')
+			throw std::runtime_error("Chunk not aligned on EOL.");
+		output = to_upper(std::string(chunk));
+	}
+};
+
+TEST_F(ParallelTest, ByChunks_Keeps_Order)
+{
+	std::string content{};
+	for (int i = 0; i < 1000; i++)
+		content += "record number " + std::to_string(i) + "\r\n";
+	std::ofstream(m_dir / "big.txt", std::ios_base::binary) << content;
+	ChunkApp app;
+	app.set_threads(4);
+	std::ostringstream out;
+	EXPECT_GT(app.ByChunks(m_dir / "big.txt", out, 1000), 1);
+	EXPECT_EQ(out.str(), to_upper(content));
+}
+
+class ChunkStatsApp : public ChunkApp
+{
+public:
+	size_t chunks{ 0 };
+
+protected:
+	virtual void SetUsage() override
+	{
+		Unnamed_Arg f{ "file" };
+		f.set_required(true);
+		us.add_Argument(f);
+		AddThreadsArgument();
+		AddStatsArgument();
+	}
+	virtual void MainProcess(const fs::path& file) override
+	{
+		std::ostringstream out;
+		chunks = ByChunks(file, out, 1000);
+	}
+	virtual void ProcessChunk(std::string_view chunk, std::string& output) override
+	{
+		ChunkApp::ProcessChunk(chunk, output);
+		AddRecords(static_cast<size_t>(std::count(chunk.begin(), chunk.end(), '\n')));
+	}
+};
+
+TEST_F(ParallelTest, ByChunks_Stats)
+{
+	std::string content{};
+	for (int i = 0; i < 1000; i++)
+		content += "record number " + std::to_string(i) + "\r\n";
+	std::ofstream(m_dir / "big.txt", std::ios_base::binary) << content;
+	for (auto threads : { "/threads:1", "/threads:4" })
+	{
+		ChunkStatsApp app;
+		std::vector<char*> argv{ "program.exe", "big.txt", const_cast<char*>(threads), "/stats" };
+		EXPECT_STREQ(app.Arguments((int)argv.size(), &argv[0]).c_str(), "");
+		EXPECT_EQ(app.Run(), 1);
+		EXPECT_GT(app.chunks, 1);
+		auto& stats = app.run_stats();
+		EXPECT_EQ(stats.files.size(), 1);
+		EXPECT_EQ(stats.records, 1000);
+		if (stats.files.size() == 1)
+			EXPECT_EQ(stats.files[0].records, 1000);
+	}
+}
+
+class PipelineApp : public ConsoleApp
+{
+public:
+	using ConsoleApp::ByPipeline;
+
+protected:
+	virtual void SetUsage() override {}
+	virtual void TransformRecord(std::string_view record, std::string_view eol, std::string& output) override
+	{
+		if (record.find("drop") != std::string_view::npos)
+			return;
+		output.append(to_upper(std::string(record)));
+		output.append(eol);
+	}
+};
+
+TEST_F(ParallelTest, ByPipeline_Transforms_Records)
+{
+	std::string content{}, expected{};
+	for (int i = 0; i < 200000; i++)
+	{
+		auto rec = (i % 3 == 0 ? "drop " : "keep ") + std::to_string(i);
+		content += rec + "\r\n";
+		if (i % 3 != 0)
+			expected += to_upper(rec) + "\r\n";
+	}
+	content += "last";
+	expected += "LAST";
+	std::ofstream(m_dir / "big.txt", std::ios_base::binary) << content;
+	for (auto backend : { IO_Backend::Sync, IO_Backend::Uring })
+	{
+		PipelineApp app;
+		app.set_io_backend(backend);
+		Pipeline_Stats stats;
+		EXPECT_EQ(app.ByPipeline(m_dir / "big.txt", m_dir / "big.out", &stats), 200001);
+		EXPECT_GT(stats.batches, 1);
+		EXPECT_EQ(stats.queues[0].capacity, 4);
+		EXPECT_EQ(stats.queues[0].pushes, stats.batches);
+		std::ifstream in(m_dir / "big.out", std::ios_base::binary);
+		std::ostringstream out;
+		out << in.rdbuf();
+		EXPECT_EQ(out.str(), expected);
+	}
+}
+
+class RecordingPipelineApp : public PipelineApp
+{
+public:
+	std::vector<std::pair<size_t, std::string>> records{};		// size and EOL of each record, the transform stage is a single thread
+
+protected:
+	virtual void TransformRecord(std::string_view record, std::string_view eol, std::string& output) override
+	{
+		records.emplace_back(record.size(), std::string(eol));
+		PipelineApp::TransformRecord(record, eol, output);
+	}
+};
+
+TEST_F(ParallelTest, ByPipeline_Long_Record)
+{
+	// a record longer than a batch must be passed whole with its EOL
+	std::string content{ "keep first\r\n" };
+	std::string long_rec(2 * 1024 * 1024 + 100, 'k');
+	content += long_rec + "\r\nkeep last\r\n";
+	std::ofstream(m_dir / "long.txt", std::ios_base::binary) << content;
+	for (auto backend : { IO_Backend::Sync, IO_Backend::Uring })
+	{
+		RecordingPipelineApp app;
+		app.set_io_backend(backend);
+		EXPECT_EQ(app.ByPipeline(m_dir / "long.txt", m_dir / "long.out"), 3);
+		ASSERT_EQ(app.records.size(), 3);
+		EXPECT_EQ(app.records[1].first, long_rec.size());
+		EXPECT_EQ(app.records[1].second, "\r\n");
+		EXPECT_EQ(app.records[2].second, "\r\n");
+		std::ifstream in(m_dir / "long.out", std::ios_base::binary);
+		std::ostringstream out;
+		out << in.rdbuf();
+		EXPECT_EQ(out.str(), to_upper(content));
+	}
+}
+
+TEST_F(ParallelTest, ByPipeline_Single_Record_Over_Several_Blocks)
+{
+	// the only record of the file spans several blocks, with and without its EOL
+	std::string record(5 * 1024 * 1024 + 10, 'k');
+	for (const auto& eol : { std::string("\n"), std::string() })
+	{
+		std::ofstream(m_dir / "single.txt", std::ios_base::binary) << record + eol;
+		for (auto backend : { IO_Backend::Sync, IO_Backend::Uring })
+		{
+			RecordingPipelineApp app;
+			app.set_io_backend(backend);
+			EXPECT_EQ(app.ByPipeline(m_dir / "single.txt", m_dir / "single.out"), 1);
+			ASSERT_EQ(app.records.size(), 1);
+			EXPECT_EQ(app.records[0].first, record.size());
+			EXPECT_EQ(app.records[0].second, eol);
+			std::ifstream in(m_dir / "single.out", std::ios_base::binary);
+			std::ostringstream out;
+			out << in.rdbuf();
+			EXPECT_EQ(out.str(), to_upper(record) + eol);
+		}
+	}
+}
+
+class FailingPipelineApp : public PipelineApp
+{
+protected:
+	virtual void TransformRecord(std::string_view record, std::string_view eol, std::string& output) override
+	{
+		if (record == "fail")
+			throw std::runtime_error("transform failed");
+		PipelineApp::TransformRecord(record, eol, output);
+	}
+};
+
+TEST_F(ParallelTest, ByPipeline_Stage_Failure)
+{
+	// the other stages are sleeping on their queues when the transform stage fails, they must be woken up
+	std::string content{};
+	for (int i = 0; i < 300000; i++)
+		content += (i == 150000 ? std::string("fail") : "keep " + std::to_string(i)) + "\n";
+	std::ofstream(m_dir / "big.txt", std::ios_base::binary) << content;
+	FailingPipelineApp app;
+	EXPECT_THROW(app.ByPipeline(m_dir / "big.txt", m_dir / "big.out"), std::runtime_error);
+}
+
 void MyApp::SetUsage()
 {
 	us.set_syntax("program.exe arguments...");
@@ -0,0 +1,379 @@
+// extsort.cpp : Defines the functions for the static library.
+//
+
+#include "pch.h"
+
+#include "extsort.hpp"
+#include "../utils/utils.hpp"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const size_t READ_BLOCK{ 1 << 20 };				// maximum size of the blocks read from the input file
+	const size_t MIN_READ_BLOCK{ 1 << 12 };			// minimum size of the blocks read from the input file
+	const size_t STREAM_BUFFER{ 1 << 16 };			// size of the buffer of each run stream
+	const size_t MAX_FANIN{ 64 };					// maximum number of runs merged at once
+
+	// A range of chars in a buffer
+	struct Range
+	{
+		size_t pos;
+		size_t len;
+	};
+
+	// Extracts and compares the keys of records
+	class Key_Extractor
+	{
+	public:
+		Key_Extractor(const std::vector<Sort_Key>& keys, char delimiter)
+			: m_keys(keys), m_delim(delimiter)
+		{
+			if (m_keys.empty())
+			{
+				m_keys.push_back(Sort_Key{});		// the whole record
+				m_delim = '\0';
+			}
+		}
+
+		size_t size() const noexcept { return m_keys.size(); }
+
+		// Sets the ranges of the keys of the record rec (EOL excluded) that starts at offset base of its buffer
+		void extract(const char* rec, size_t len, size_t base, Range* ranges) const
+		{
+			for (size_t k = 0; k < m_keys.size(); k++)
+			{
+				auto& key = m_keys[k];
+				size_t pos{ 0 }, end{ len };
+				if (m_delim == '\0')
+					pos = std::min(key.pos, len);
+				else
+				{
+					// skips key.pos fields
+					for (size_t f = 0; f < key.pos && pos < len; f++)
+					{
+						auto next = static_cast<const char*>(std::memchr(rec + pos, m_delim, len - pos));
+						pos = next == nullptr ? len : static_cast<size_t>(next - rec) + 1;
+					}
+					auto next = static_cast<const char*>(std::memchr(rec + pos, m_delim, len - pos));
+					end = next == nullptr ? len : static_cast<size_t>(next - rec);
+				}
+				if (key.len != 0 && key.len < end - pos)
+					end = pos + key.len;
+				ranges[k] = { base + pos, end - pos };
+			}
+		}
+
+		// Returns a negative value if record a is before record b, 0 if their keys are equal and a positive value else
+		int compare(const char* a, const Range* ka, const char* b, const Range* kb) const
+		{
+			for (size_t k = 0; k < m_keys.size(); k++)
+			{
+				auto pa = a + ka[k].pos;
+				auto pb = b + kb[k].pos;
+				auto len = std::min(ka[k].len, kb[k].len);
+				int result{ 0 };
+				if (m_keys[k].ignore_case)
+				{
+					for (size_t i = 0; i < len && result == 0; i++)
+						result = std::tolower(static_cast<unsigned char>(pa[i])) - std::tolower(static_cast<unsigned char>(pb[i]));
+				}
+				else if (len > 0)
+					result = std::memcmp(pa, pb, len);
+				if (result == 0)
+					result = ka[k].len < kb[k].len ? -1 : (ka[k].len > kb[k].len ? 1 : 0);
+				if (result != 0)
+					return m_keys[k].descending ? -result : result;
+			}
+			return 0;
+		}
+
+	private:
+		std::vector<Sort_Key> m_keys;
+		char m_delim;
+	};
+
+	// Returns the length of the record without its EOL
+	size_t body_length(const char* rec, size_t len, const std::string& eol)
+	{
+		if (len >= eol.size() && std::equal(eol.begin(), eol.end(), rec + len - eol.size()))
+			return len - eol.size();
+		return len - 1;			// a single LF in a file with CR+LF EOL
+	}
+
+	std::atomic<unsigned long long> sort_count{ 0 };	// makes the names of the runs unique among the sorts of the process
+
+	// Returns the id of the current process, which makes the names of the runs unique among processes
+	long process_id()
+	{
+#ifdef _WIN32
+		return static_cast<long>(_getpid());
+#else
+		return static_cast<long>(getpid());
+#endif // _WIN32
+	}
+
+	// Creates the names of the runs and removes the files left at destruction
+	class Temp_Files
+	{
+	public:
+		Temp_Files(const fs::path& dir)
+			: m_dir(dir), m_prefix("extsort_" + std::to_string(process_id()) + "_" + std::to_string(sort_count++) + "_") {}
+		~Temp_Files()
+		{
+			std::error_code ec;
+			for (auto& file : m_files)
+				fs::remove(file, ec);
+		}
+
+		fs::path create()
+		{
+			m_files.push_back(m_dir / (m_prefix + std::to_string(m_files.size()) + ".tmp"));
+			return m_files.back();
+		}
+
+		void remove(const fs::path& file)
+		{
+			std::error_code ec;
+			fs::remove(file, ec);
+		}
+
+	private:
+		fs::path m_dir;
+		std::string m_prefix;
+		std::vector<fs::path> m_files{};
+	};
+
+	// Sequential reader of the records of a run
+	class Run_Reader
+	{
+	public:
+		Run_Reader(const fs::path& file, const Key_Extractor& keys, const std::string& eol)
+			: m_buffer(STREAM_BUFFER), m_keys(keys), m_eol(eol), m_ranges(keys.size())
+		{
+			m_in.rdbuf()->pubsetbuf(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+			m_in.open(file, std::ios_base::binary | std::ios_base::in);
+			if (!m_in.is_open())
+				throw fs::filesystem_error("Unable to open the run.", file, std::make_error_code(std::errc::io_error));
+			next();
+		}
+
+		// Reads the next record, returns false at the end of the run
+		bool next()
+		{
+			if (m_done)
+				return false;
+			if (!std::getline(m_in, m_rec, m_eol.back()))
+				return !(m_done = true);
+			m_rec.push_back(m_eol.back());
+			m_keys.extract(m_rec.data(), body_length(m_rec.data(), m_rec.size(), m_eol), 0, m_ranges.data());
+			return true;
+		}
+
+		bool done() const noexcept { return m_done; }
+		const std::string& record() const noexcept { return m_rec; }
+		const Range* ranges() const noexcept { return m_ranges.data(); }
+
+	private:
+		std::vector<char> m_buffer;
+		std::ifstream m_in{};
+		const Key_Extractor& m_keys;
+		const std::string& m_eol;
+		std::string m_rec{};
+		std::vector<Range> m_ranges;
+		bool m_done{ false };
+	};
+
+	// Tournament tree of losers: m_tree[0] is the index of the winner source and the other nodes keep the losers of their match.
+	// Replacing the winner only replays the matches on the path from its leaf to the root, so log2(k) comparisons per record.
+	template <class Less>
+	class Loser_Tree
+	{
+	public:
+		Loser_Tree(size_t k, Less less)
+			: m_k(k), m_less(less), m_tree(std::max(k, static_cast<size_t>(1)))
+		{
+			// the leaves of the sources are the virtual nodes k to 2k-1
+			std::vector<size_t> winners(2 * k);
+			for (size_t i = 0; i < k; i++)
+				winners[k + i] = i;
+			for (size_t n = k - 1; n > 0; n--)
+			{
+				auto l = winners[2 * n];
+				auto r = winners[2 * n + 1];
+				bool left = !m_less(r, l);
+				winners[n] = left ? l : r;
+				m_tree[n] = left ? r : l;
+			}
+			m_tree[0] = k > 1 ? winners[1] : 0;
+		}
+
+		size_t winner() const noexcept { return m_tree[0]; }
+
+		// Replays the matches of the winner after its source has been updated
+		void replay()
+		{
+			auto winner = m_tree[0];
+			for (auto n = (winner + m_k) / 2; n > 0; n /= 2)
+				if (m_less(m_tree[n], winner))
+					std::swap(m_tree[n], winner);
+			m_tree[0] = winner;
+		}
+
+	private:
+		size_t m_k;
+		Less m_less;
+		std::vector<size_t> m_tree;
+	};
+
+	// Merges the runs into the output file and returns the number of records
+	size_t merge(const std::vector<fs::path>& runs, const fs::path& output, const Key_Extractor& keys, const std::string& eol)
+	{
+		std::vector<std::unique_ptr<Run_Reader>> readers{};
+		for (auto& run : runs)
+			readers.push_back(std::make_unique<Run_Reader>(run, keys, eol));
+		// exhausted runs lose every match, and equal keys are ordered by run to keep the sort stable
+		auto less = [&readers, &keys](size_t a, size_t b)
+		{
+			if (readers[a]->done() || readers[b]->done())
+				return !readers[a]->done();
+			auto result = keys.compare(readers[a]->record().data(), readers[a]->ranges(), readers[b]->record().data(), readers[b]->ranges());
+			return result < 0 || (result == 0 && a < b);
+		};
+		Loser_Tree<decltype(less)> tree(readers.size(), less);
+		std::vector<char> buffer(STREAM_BUFFER);
+		std::ofstream out{};
+		out.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		out.open(output, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+		if (!out.is_open())
+			throw fs::filesystem_error("Unable to create the file.", output, std::make_error_code(std::errc::io_error));
+		size_t nbrecs{ 0 };
+		while (!readers.empty() && !readers[tree.winner()]->done())
+		{
+			auto& reader = readers[tree.winner()];
+			out.write(reader->record().data(), static_cast<std::streamsize>(reader->record().size()));
+			nbrecs++;
+			reader->next();
+			tree.replay();
+		}
+		out.close();
+		if (out.fail())
+			throw fs::filesystem_error("Unable to write the file.", output, std::make_error_code(std::errc::io_error));
+		return nbrecs;
+	}
+}
+
+size_t ExtSort::sort(const fs::path& input, const fs::path& output)
+{
+	Key_Extractor keys(this->keys, delimiter);
+	const auto nbkeys = keys.size();
+	auto eol_type = file_EOL(input);
+	if (eol_type == EOL::Unknown)
+#ifdef _WIN32
+		eol_type = EOL::Windows;
+#else
+		eol_type = EOL::Unix;
+#endif // _WIN32
+	const std::string eol{ EOL_str(eol_type) };
+	std::ifstream in(input, std::ios_base::binary | std::ios_base::in);
+	if (!in.is_open())
+		throw fs::filesystem_error("Unable to open the file.", input, std::make_error_code(std::errc::no_such_file_or_directory));
+	std::error_code ec;
+	auto filesize = fs::file_size(input, ec);
+
+	Temp_Files temp(tempdir);
+	std::vector<fs::path> runs{};
+	std::string buffer{};
+	buffer.reserve(static_cast<size_t>(std::min(static_cast<std::uintmax_t>(memory), ec ? 0 : filesize)) + READ_BLOCK);
+	std::string carry{};
+	std::vector<Range> recs{};
+	std::vector<Range> ranges{};
+	std::vector<size_t> order{};
+	size_t nbrecs{ 0 };
+	bool eof{ false };
+	m_runs = 0;
+	while (!eof)
+	{
+		// reads the records up to the memory budget, the incomplete record at end of the buffer is carried to the next run
+		buffer.assign(carry);
+		recs.clear();
+		ranges.clear();
+		size_t parsed{ 0 };
+		auto used = [&]() { return buffer.size() + recs.size() * ((nbkeys + 1) * sizeof(Range) + sizeof(size_t)); };
+		while (!eof && (used() < memory || recs.empty()))
+		{
+			auto size = buffer.size();
+			auto block = used() < memory ? std::clamp(memory - used(), MIN_READ_BLOCK, READ_BLOCK) : READ_BLOCK;
+			buffer.resize(size + block);
+			in.read(&buffer[size], static_cast<std::streamsize>(block));
+			buffer.resize(size + static_cast<size_t>(in.gcount()));
+			if (in.bad())
+				throw fs::filesystem_error("Unable to read the file.", input, std::make_error_code(std::errc::io_error));
+			eof = in.eof();
+			if (eof && !buffer.empty() && buffer.back() != eol.back())
+				buffer.append(eol);			// the last record always ends with an EOL
+			for (auto end = buffer.find(eol.back(), parsed); end != std::string::npos; end = buffer.find(eol.back(), parsed))
+			{
+				recs.push_back({ parsed, end + 1 - parsed });
+				ranges.resize(ranges.size() + nbkeys);
+				keys.extract(buffer.data() + parsed, body_length(buffer.data() + parsed, end + 1 - parsed, eol), parsed, &ranges[ranges.size() - nbkeys]);
+				parsed = end + 1;
+			}
+		}
+		carry.assign(buffer, parsed, std::string::npos);
+		order.resize(recs.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+			{ return keys.compare(buffer.data(), &ranges[a * nbkeys], buffer.data(), &ranges[b * nbkeys]) < 0; });
+
+		// a single run is directly written to the output file
+		fs::path dest{};
+		if (eof && runs.empty())
+		{
+			in.close();
+			dest = output;
+		}
+		else
+		{
+			dest = temp.create();
+			runs.push_back(dest);
+		}
+		std::ofstream out(dest, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+		if (!out.is_open())
+			throw fs::filesystem_error("Unable to create the file.", dest, std::make_error_code(std::errc::io_error));
+		for (auto i : order)
+			out.write(buffer.data() + recs[i].pos, static_cast<std::streamsize>(recs[i].len));
+		out.close();
+		if (out.fail())
+			throw fs::filesystem_error("Unable to write the file.", dest, std::make_error_code(std::errc::io_error));
+		nbrecs += recs.size();
+		m_runs++;
+	}
+	if (runs.empty())
+		return nbrecs;
+	in.close();
+	buffer = std::string{};		// releases the memory before merging
+
+	// merges the runs by groups of MAX_FANIN until the last merge that produces the output file
+	while (runs.size() > MAX_FANIN)
+	{
+		// the merged runs keep the order of their records in the input file, so the sort remains stable
+		std::vector<fs::path> merged{};
+		for (size_t i = 0; i < runs.size(); i += MAX_FANIN)
+		{
+			std::vector<fs::path> group(runs.begin() + i, runs.begin() + std::min(i + MAX_FANIN, runs.size()));
+			if (group.size() == 1)
+			{
+				merged.push_back(group.front());
+				continue;
+			}
+			merged.push_back(temp.create());
+			merge(group, merged.back(), keys, eol);
+			for (auto& run : group)
+				temp.remove(run);
+		}
+		runs = merged;
+	}
+	merge(runs, output, keys, eol);
+	return nbrecs;
+}
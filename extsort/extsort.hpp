@@ -0,0 +1,58 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
+
+/*! \file extsort.hpp
+*	\brief Implements the class ExtSort that sorts text files on several keys.
+*   \author Christophe COUAILLET
+*/
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/*! \brief Defines a sort key of the class ExtSort. */
+struct Sort_Key
+{
+	/*! \brief Position of the key: offset of the first char in fixed width records, index of the field in delimited records. Both start at 0. */
+	size_t pos{ 0 };
+	/*! \brief Length of the key in chars. The value 0 means up to the end of the record in fixed width records, the whole field in delimited records. */
+	size_t len{ 0 };
+	/*! \brief Sets or gets the descending order of the key. */
+	bool descending{ false };
+	/*! \brief Sets or gets the case insensitive comparison of the key. */
+	bool ignore_case{ false };
+};
+
+/*! \brief An external sort engine for text files.
+
+	The records of the input file are read in memory up to the memory budget, sorted on the keys and written to temporary files named runs.
+	Then the runs are merged with a loser tree to produce the output file. If the whole input file fits in the memory budget, it is directly written to the output file.
+	Records are delimited by the EOL detected by the function file_EOL, and the sort is stable: records with equal keys keep their input order.
+	Keys are either fixed width columns or fields delimited by a char.
+*/
+class ExtSort
+{
+public:
+	/*! \brief Sets or gets the list of keys, by decreasing priority. If empty, the whole record is the key. */
+	std::vector<Sort_Key> keys{};
+	/*! \brief Sets or gets the delimiter of fields. The value '\0' means fixed width records. */
+	char delimiter{ '\0' };
+	/*! \brief Sets or gets the memory budget in bytes used to store the records and their index when the runs are generated. */
+	size_t memory{ 256 << 20 };
+	/*! \brief Sets or gets the directory where the runs are written. */
+	std::filesystem::path tempdir{ std::filesystem::temp_directory_path() };
+
+	/*! \brief Sorts the input file into the output file and returns the number of records.
+	*
+	*	The output file is created once the input file has been completely read, so it can be the same than the input file.
+	*	The output records end with the EOL of the input file, including the last one.
+	*	\throws A filesystem_error exception if the input file can't be read or if a temporary or the output file can't be written.
+	*/
+	size_t sort(const std::filesystem::path& input, const std::filesystem::path& output);
+	/*! \brief Returns the number of runs generated by the last call to sort. */
+	size_t runs() const noexcept { return m_runs; }
+
+private:
+	size_t m_runs{ 0 };
+};
@@ -0,0 +1,99 @@
+#include "pch.h"
+#include "../extsort/extsort.hpp"
+
+namespace fs = std::filesystem;
+
+class ExtSortTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		m_dir = fs::temp_directory_path() / "extsort_test";
+		fs::create_directories(m_dir);
+		m_input = m_dir / "input.txt";
+		m_output = m_dir / "output.txt";
+	}
+
+	void TearDown() override { fs::remove_all(m_dir); }
+
+	void write(const std::vector<std::string>& records, const std::string& eol)
+	{
+		std::ofstream out(m_input, std::ios_base::binary);
+		for (auto& rec : records)
+			out << rec << eol;
+	}
+
+	std::string read()
+	{
+		std::ifstream in(m_output, std::ios_base::binary);
+		std::ostringstream os;
+		os << in.rdbuf();
+		return os.str();
+	}
+
+	fs::path m_dir;
+	fs::path m_input;
+	fs::path m_output;
+	ExtSort m_sort;
+};
+
+TEST_F(ExtSortTest, Whole_Record)
+{
+	write({ "delta", "alpha", "charlie", "bravo" }, "\r\n");
+	EXPECT_EQ(m_sort.sort(m_input, m_output), 4);
+	EXPECT_EQ(m_sort.runs(), 1);
+	EXPECT_EQ(read(), "alpha\r\nbravo\r\ncharlie\r\ndelta\r\n");
+}
+
+TEST_F(ExtSortTest, Fixed_Width_Keys)
+{
+	write({ "0002B20200101", "0001A20200301", "0001B20200201", "0002A20200101" }, "\n");
+	m_sort.keys = { Sort_Key{ 4, 1 }, Sort_Key{ 5, 8, true } };
+	EXPECT_EQ(m_sort.sort(m_input, m_output), 4);
+	EXPECT_EQ(read(), "0001A20200301\n0002A20200101\n0001B20200201\n0002B20200101\n");
+}
+
+TEST_F(ExtSortTest, Delimited_Keys)
+{
+	write({ "x;Beta;2", "y;alpha;10", "z;beta;1", "w;Alpha;3" }, "\n");
+	m_sort.delimiter = ';';
+	m_sort.keys = { Sort_Key{ 1, 0, false, true }, Sort_Key{ 2, 1 } };
+	EXPECT_EQ(m_sort.sort(m_input, m_output), 4);
+	EXPECT_EQ(read(), "y;alpha;10\nw;Alpha;3\nz;beta;1\nx;Beta;2\n");
+}
+
+TEST_F(ExtSortTest, Last_Record_Without_EOL)
+{
+	std::ofstream(m_input, std::ios_base::binary) << "b\na";
+	EXPECT_EQ(m_sort.sort(m_input, m_output), 2);
+	EXPECT_EQ(read(), "a\nb\n");
+}
+
+TEST_F(ExtSortTest, Many_Runs_Are_Stable)
+{
+	// 5000 records of about 100 bytes with a memory budget of 4 KB give more runs than merged at once
+	std::vector<std::string> records{};
+	for (int i = 0; i < 5000; i++)
+		records.push_back(std::to_string((i * 7919) % 97) + ";" + std::to_string(i) + std::string(90, '.'));
+	write(records, "\n");
+	m_sort.delimiter = ';';
+	m_sort.keys = { Sort_Key{ 0 } };
+	m_sort.memory = 4096;
+	EXPECT_EQ(m_sort.sort(m_input, m_output), 5000);
+	EXPECT_GT(m_sort.runs(), 64);
+	std::stable_sort(records.begin(), records.end(), [](const std::string& a, const std::string& b)
+		{ return a.substr(0, a.find(';')) < b.substr(0, b.find(';')); });
+	std::string expected{};
+	for (auto& rec : records)
+		expected += rec + "\n";
+	EXPECT_EQ(read(), expected);
+}
+
+TEST_F(ExtSortTest, Input_Is_Output)
+{
+	write({ "2", "3", "1" }, "\n");
+	m_sort.memory = 1;
+	EXPECT_EQ(m_sort.sort(m_input, m_input), 3);
+	m_output = m_input;
+	EXPECT_EQ(read(), "1\n2\n3\n");
+}
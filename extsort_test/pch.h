@@ -0,0 +1,15 @@
+//
+// pch.h
+// Header for standard system include files.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
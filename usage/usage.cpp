@@ -433,13 +433,18 @@ void Usage::set_syntax(const std::string& syntax)
     m_syntax_valid = true;
 }
 
+namespace
+{
+    // the formats are template arguments of format_message, that checks their number of arguments at compile time
+    constexpr char SYNTAX_ERROR[]{ "Error found in command line argument number %i: '%s' - see %s /? for help." };
+    constexpr char TYPE_MISMATCH[]{ "Argument '%s' passed as '%s' while expected type is '%s' - see %s /? for help." };
+    constexpr char UNKNOW_ARGUMENT[]{ "Unknown argument '/%s' - see %s /? for help." };
+    constexpr char REQUIRED_ARGUMENT[]{ "Missing required argument '%s' - see %s /? for help." };
+    constexpr char CONFLICT[]{ "Arguments '%s' and '%s' can't be used together - see %s /? for help." };
+}
+
 std::string Usage::set_parameters(int argc, char* argv[])
 {
-    static const char* SYNTAX_ERROR{ "Error found in command line argument number %i: '%s' - see %s /? for help." };
-    static const char* TYPE_MISMATCH{ "Argument '%s' passed as '%s' while expected type is '%s' - see %s /? for help." };
-    static const char* UNKNOW_ARGUMENT{ "Unknown argument '/%s' - see %s /? for help." };
-    static const char* REQUIRED_ARGUMENT{ "Missing required argument '%s' - see %s /? for help." };
-    static const char* CONFLICT{ "Arguments '%s' and '%s' can't be used together - see %s /? for help." };
     if (argc == 0)
         return "No argument to evaluate.";
     std::vector<bool> set_args(m_argsorder.size(), false);
@@ -454,7 +459,7 @@ std::string Usage::set_parameters(int argc, char* argv[])
         if (named)
             p.erase(0, 1);
         if (p.empty())
-            return get_message(SYNTAX_ERROR, i, argv[i], program_name.c_str());
+            return format_message<SYNTAX_ERROR>(i, argv[i], program_name);
         if (p == "?")
             // Help requested
             return "?";
@@ -463,11 +468,7 @@ std::string Usage::set_parameters(int argc, char* argv[])
         std::string value{};
         if (!named)
         {
-            value = p;
-            if (quoted)
-            {
-                // TODO format value inside quotes
-            }
+            value = quoted ? unquote(p) : p;
             if (many)
                 m_argsorder[unnamed]->value.push_back(value);
             else
@@ -486,19 +487,18 @@ std::string Usage::set_parameters(int argc, char* argv[])
                     }
                 }
                 if (!found)
-                    return get_message(SYNTAX_ERROR, i, argv[i], program_name.c_str());
+                    return format_message<SYNTAX_ERROR>(i, argv[i], program_name);
             }
             continue;
         }
         many = false;
         if (quoted)
         {
-            value = p.substr(quote + 1, p.length() - quote - 1);
+            value = unquote(std::string_view(p).substr(quote));
             p.erase(quote, p.length() - 1);
-            // TODO format value inside quotes
         }
         if (p.empty())
-            return get_message(SYNTAX_ERROR, i, argv[i], program_name.c_str());
+            return format_message<SYNTAX_ERROR>(i, argv[i], program_name);
         Argument_Type type_p{ Argument_Type::simple };
         auto colon = p.find(':');
         if (colon != std::string::npos)
@@ -516,7 +516,7 @@ std::string Usage::set_parameters(int argc, char* argv[])
                 type_p = Argument_Type::boolean;
                 p.erase(p.length() - 1);
                 if (!value.empty())
-                    return get_message(SYNTAX_ERROR, i, argv[i], program_name.c_str());
+                    return format_message<SYNTAX_ERROR>(i, argv[i], program_name);
                 value = "false";
                 if (sgn == '+')
                     value = "true";
@@ -525,12 +525,12 @@ std::string Usage::set_parameters(int argc, char* argv[])
             {
                 // simple argument
                 if (!value.empty())
-                    return get_message(SYNTAX_ERROR, i, argv[i], program_name.c_str());
+                    return format_message<SYNTAX_ERROR>(i, argv[i], program_name);
                 value = "true";
             }
         }
         if (p.empty())
-            return get_message(SYNTAX_ERROR, i, argv[i], program_name.c_str());
+            return format_message<SYNTAX_ERROR>(i, argv[i], program_name);
         bool found{ false };
         for (size_t i = 0; i < m_argsorder.size(); i++)
         {
@@ -542,8 +542,8 @@ std::string Usage::set_parameters(int argc, char* argv[])
                 {
                     Argument_Type type_a = dynamic_cast<Named_Arg*>(m_argsorder[i])->type();
                     if (type_p != type_a)
-                        return get_message(TYPE_MISMATCH, m_argsorder[i]->name().c_str(),
-                            AType_toStr(type_p).c_str(), AType_toStr(type_a).c_str(), program_name.c_str());
+                        return format_message<TYPE_MISMATCH>(m_argsorder[i]->name(),
+                            AType_toStr(type_p), AType_toStr(type_a), program_name);
                     m_argsorder[i]->value.push_back(value);
                     set_args[i] = true;
                     found = true;
@@ -552,7 +552,7 @@ std::string Usage::set_parameters(int argc, char* argv[])
             }
         }
         if (!found)
-            return get_message(UNKNOW_ARGUMENT, p.c_str(), program_name.c_str());
+            return format_message<UNKNOW_ARGUMENT>(p, program_name);
     }
     for (size_t i = 0; i < m_argsorder.size(); i++)
     {
@@ -575,7 +575,7 @@ std::string Usage::set_parameters(int argc, char* argv[])
                 }
             }
             if (!con_defined)
-                return get_message(REQUIRED_ARGUMENT, m_argsorder[i]->name().c_str(), program_name.c_str());
+                return format_message<REQUIRED_ARGUMENT>(m_argsorder[i]->name(), program_name);
         }
         if (!set_args[i] && m_argsorder[i]->named())
         {
@@ -617,9 +617,9 @@ std::string Usage::set_parameters(int argc, char* argv[])
                 if (i != j)
                 {
                     if (set_args[j] && m_conflicts.in_conflict(m_argsorder[i], m_argsorder[j]))
-                        return get_message(CONFLICT, m_argsorder[i]->name().c_str(), m_argsorder[j]->name().c_str(), program_name.c_str());
+                        return format_message<CONFLICT>(m_argsorder[i]->name(), m_argsorder[j]->name(), program_name);
                     if (!set_args[j] && m_requirements.requires(m_argsorder[i], m_argsorder[j]))
-                        return get_message(REQUIRED_ARGUMENT, m_argsorder[j]->name().c_str(), program_name.c_str());
+                        return format_message<REQUIRED_ARGUMENT>(m_argsorder[j]->name(), program_name);
                 }
             }
         }
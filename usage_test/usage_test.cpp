@@ -247,3 +247,12 @@ TEST_F(UsageTest, Set_Parameters8)
 	auto msg = us.set_parameters((int)argv.size(), &argv[0]);
 	EXPECT_STREQ(msg.c_str(), "");
 }
+
+TEST_F(UsageTest, Set_Parameters_Quoted_Values)
+{
+	std::vector<char*> argv{ "program.exe", "\"files \"\"1\"\".txt\"", "/f:3,7", "/r", "/n:\"a;\"\"b\"\"\"" };
+	auto msg = us.set_parameters((int)argv.size(), &argv[0]);
+	EXPECT_STREQ(msg.c_str(), "");
+	EXPECT_EQ(us.get_Argument("decimal_separator")->value.front(), "a;\"b\"");
+	EXPECT_EQ(us.get_Argument("file")->value.front(), "files \"1\".txt");
+}
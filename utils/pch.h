@@ -9,15 +9,44 @@
 
 // add headers that you want to pre-compile here
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
 #include <cstdarg>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <fstream>
-#include <regex>
+#include <limits>
+#include <new>
 #include <sstream>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__)
+#define UTILS_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86_FP) && _M_IX86_FP >= 2
+#define UTILS_SSE2
+#include <emmintrin.h>
+#endif
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define UTILS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
 #endif // _WIN32
 
 #endif //PCH_H
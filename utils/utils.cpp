@@ -12,30 +12,225 @@ std::string get_message(const char* fmt...)
     va_start(args1, fmt);
     va_list args2;
     va_copy(args2, args1);
-    std::vector<char> msg(static_cast<size_t>(std::vsnprintf(nullptr, 0, fmt, args1)) + 1);
+    int len = std::vsnprintf(nullptr, 0, fmt, args1);
     va_end(args1);
-    std::vsnprintf(msg.data(), msg.size(), fmt, args2);
+    std::string mesg{};
+    if (len > 0)
+    {
+        // the terminating null character is written in the extra char of the string buffer, not in the string itself
+        mesg.resize(static_cast<size_t>(len));
+        std::vsnprintf(mesg.data(), mesg.size() + 1, fmt, args2);
+    }
     va_end(args2);
-    std::string mesg(msg.begin(), msg.end());
     return mesg;
 }
 
+namespace
+{
+    template <typename T>
+    void append_printf(std::string& buffer, std::string_view spec, const char* length, char conv, T value)
+    // appends value formatted by snprintf with the conversion "%" + spec + length + conv, without allocating a temporary string
+    {
+        char fmt[32]{ '%' };
+        size_t pos{ 1 };
+        for (size_t i = 0; i < spec.size() && pos < sizeof(fmt) - 4; ++i)
+            fmt[pos++] = spec[i];
+        for (; *length != '\0'; ++length)
+            fmt[pos++] = *length;
+        fmt[pos++] = conv;
+        fmt[pos] = '\0';
+        char tmp[128];
+        int len = std::snprintf(tmp, sizeof(tmp), fmt, value);
+        if (len < 0)
+            return;
+        if (static_cast<size_t>(len) < sizeof(tmp))
+        {
+            buffer.append(tmp, static_cast<size_t>(len));
+            return;
+        }
+        size_t old = buffer.size();
+        buffer.resize(old + static_cast<size_t>(len));
+        std::snprintf(buffer.data() + old, static_cast<size_t>(len) + 1, fmt, value);
+    }
+
+    void append_padded(std::string& buffer, std::string_view spec, std::string_view str)
+    // appends str truncated to the precision and padded with spaces to the width of spec, on the right if the flag '-' is set
+    {
+        bool left{ false };
+        size_t i{ 0 };
+        for (; i < spec.size() && std::strchr("-+ #0", spec[i]) != nullptr; ++i)
+            left = left || spec[i] == '-';
+        size_t width{ 0 };
+        for (; i < spec.size() && spec[i] >= '0' && spec[i] <= '9'; ++i)
+            width = width * 10 + static_cast<size_t>(spec[i] - '0');
+        if (i < spec.size() && spec[i] == '.')
+        {
+            size_t precision{ 0 };
+            for (++i; i < spec.size() && spec[i] >= '0' && spec[i] <= '9'; ++i)
+                precision = precision * 10 + static_cast<size_t>(spec[i] - '0');
+            str = str.substr(0, precision);
+        }
+        size_t pad = width > str.size() ? width - str.size() : 0;
+        if (!left)
+            buffer.append(pad, ' ');
+        buffer.append(str);
+        if (left)
+            buffer.append(pad, ' ');
+    }
+}
+
+void Message_Arg::append_to(std::string& buffer, std::string_view spec, char conv) const
+// the conversion letter only selects the notation of numbers, the type of the value is always respected
+{
+    switch (m_type)
+    {
+    case Type::String:
+        append_padded(buffer, spec, m_str);
+        break;
+    case Type::Char:
+        append_padded(buffer, spec, std::string_view(&m_char, 1));
+        break;
+    case Type::Bool:
+        if (conv == 's')
+        {
+            append_padded(buffer, spec, m_int != 0 ? "true" : "false");
+            break;
+        }
+        [[fallthrough]];
+    case Type::Int:
+        append_printf(buffer, spec, "ll", std::strchr("oxX", conv) != nullptr ? conv : 'd', m_int);
+        break;
+    case Type::Uint:
+        append_printf(buffer, spec, "ll", std::strchr("oxX", conv) != nullptr ? conv : 'u', m_uint);
+        break;
+    case Type::Float:
+        append_printf(buffer, spec, "", std::strchr("aAeEfFgG", conv) != nullptr ? conv : 'g', m_float);
+        break;
+    }
+}
+
+void append_message(std::string& buffer, const char* fmt, const Message_Arg* args, size_t count)
+// copies the text between the conversion specifications, whose length modifiers are ignored as the type of the arguments is known
+{
+    size_t next{ 0 };
+    while (*fmt != '\0')
+    {
+        const char* pct = std::strchr(fmt, '%');
+        if (pct == nullptr)
+        {
+            buffer.append(fmt);
+            break;
+        }
+        buffer.append(fmt, static_cast<size_t>(pct - fmt));
+        if (pct[1] == '%')
+        {
+            buffer.push_back('%');
+            fmt = pct + 2;
+            continue;
+        }
+        const char* end = pct + 1;
+        while (*end != '\0' && std::strchr("-+ #0123456789.", *end) != nullptr)
+            ++end;
+        std::string_view spec(pct + 1, static_cast<size_t>(end - pct - 1));
+        while (*end != '\0' && std::strchr("hlLjzt", *end) != nullptr)
+            ++end;
+        if (*end == '\0')
+        {
+            // an incomplete specification at the end of the format is printed as is
+            buffer.append(pct);
+            break;
+        }
+        if (next < count)
+            args[next++].append_to(buffer, spec, *end);
+        fmt = end + 1;
+    }
+}
+
+namespace
+{
+    template <bool Upper>
+    void convert_case(const char* src, char* dest, size_t len) noexcept
+    // ASCII letters are those between first and last, the case bit 0x20 is set for lower case or cleared for upper case
+    {
+        constexpr char first{ Upper ? 'a' : 'A' };
+        constexpr char last{ Upper ? 'z' : 'Z' };
+        size_t i{ 0 };
+        auto scalar = [&](size_t end)
+        {
+            for (; i < end; i++)
+            {
+                auto c = static_cast<unsigned char>(src[i]);
+                dest[i] = static_cast<char>(Upper ? std::toupper(c) : std::tolower(c));
+            }
+        };
+#ifdef UTILS_AVX2
+        const __m256i first32 = _mm256_set1_epi8(first - 1);
+        const __m256i last32 = _mm256_set1_epi8(last + 1);
+        const __m256i bit32 = _mm256_set1_epi8(0x20);
+        for (; i + 32 <= len; )
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            if (_mm256_movemask_epi8(v) != 0)
+            {
+                scalar(i + 32);     // non-ASCII chars depend on the locale
+                continue;
+            }
+            // the chars are ASCII so the signed comparisons are valid
+            __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(v, first32), _mm256_cmpgt_epi8(last32, v));
+            __m256i flip = _mm256_and_si256(letters, bit32);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), _mm256_xor_si256(v, flip));
+            i += 32;
+        }
+#endif // UTILS_AVX2
+#ifdef UTILS_SSE2
+        const __m128i first16 = _mm_set1_epi8(first - 1);
+        const __m128i last16 = _mm_set1_epi8(last + 1);
+        const __m128i bit16 = _mm_set1_epi8(0x20);
+        for (; i + 16 <= len; )
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            if (_mm_movemask_epi8(v) != 0)
+            {
+                scalar(i + 16);     // non-ASCII chars depend on the locale
+                continue;
+            }
+            // the chars are ASCII so the signed comparisons are valid
+            __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(v, first16), _mm_cmplt_epi8(v, last16));
+            __m128i flip = _mm_and_si128(letters, bit16);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_xor_si128(v, flip));
+            i += 16;
+        }
+#endif // UTILS_SSE2
+        scalar(len);
+    }
+}
+
 std::string to_lower(const std::string& str)
 // converts str to lower case
 {
-    std::string s{ str };
-    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    std::string s(str.size(), '\0');
+    convert_case<false>(str.data(), &s[0], str.size());
     return s;
 }
 
 std::string to_upper(const std::string& str)
 // converts str to upper case
 {
-    std::string s{ str };
-    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::toupper(c); });
+    std::string s(str.size(), '\0');
+    convert_case<true>(str.data(), &s[0], str.size());
     return s;
 }
 
+void to_lower(std::string_view src, char* dest) noexcept
+{
+    convert_case<false>(src.data(), dest, src.size());
+}
+
+void to_upper(std::string_view src, char* dest) noexcept
+{
+    convert_case<true>(src.data(), dest, src.size());
+}
+
 #ifdef _WIN32
 std::wstring str_to_wstr(const std::string& str, unsigned int codepage)
 {
@@ -48,62 +243,455 @@ std::wstring str_to_wstr(const std::string& str, unsigned int codepage)
 }
 #endif // _WIN32
 
-void replace_all(std::string& source, char replace, const std::string& replacement)
+namespace
+{
+    constexpr unsigned char ascii_lower(unsigned char c) noexcept
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+    }
+
+    constexpr unsigned char ascii_upper(unsigned char c) noexcept
+    {
+        return c >= 'a' && c <= 'z' ? static_cast<unsigned char>(c - ('a' - 'A')) : c;
+    }
+}
+
+Glob::Glob(std::string_view pattern, bool classes)
+{
+    size_t i{ 0 };
+    while (i < pattern.size())
+    {
+        auto c = static_cast<unsigned char>(pattern[i]);
+        if (c == '*')
+        {
+            if (m_tokens.empty() || m_tokens.back().op != Op::Star)     // consecutive stars are useless
+                m_tokens.push_back(Token{ Op::Star });
+            i++;
+            continue;
+        }
+        if (c == '?')
+        {
+            m_tokens.push_back(Token{ Op::Any });
+            i++;
+            continue;
+        }
+        if (c == '[' && classes)
+        {
+            size_t j{ i + 1 };
+            bool negate{ false };
+            if (j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^'))
+            {
+                negate = true;
+                j++;
+            }
+            std::array<bool, 256> set{};
+            bool first{ true };
+            while (j < pattern.size() && (first || pattern[j] != ']'))
+            {
+                auto from = static_cast<unsigned char>(pattern[j]);
+                auto to = from;
+                if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']')
+                {
+                    to = static_cast<unsigned char>(pattern[j + 2]);
+                    j += 2;
+                }
+                for (unsigned int k = from; k <= to; k++)
+                {
+                    set[ascii_lower(static_cast<unsigned char>(k))] = true;
+                    set[ascii_upper(static_cast<unsigned char>(k))] = true;
+                }
+                first = false;
+                j++;
+            }
+            if (j < pattern.size())
+            {
+                if (negate)
+                    for (auto& b : set)
+                        b = !b;
+                m_tokens.push_back(Token{ Op::Class, m_classes.size() });
+                m_classes.push_back(set);
+                i = j + 1;
+                continue;
+            }
+            // unterminated class: [ is an ordinary char
+        }
+        m_tokens.push_back(Token{ Op::Char, ascii_lower(c) });
+        i++;
+    }
+}
+
+template <typename Char>
+bool Glob::match_impl(const Char* name, size_t len) const noexcept
+// matches with backtracking to the last star only, which is enough as a star matches any sequence
 {
-    size_t pos{ 0 };
-    while (pos < source.length() && (pos = source.find(replace, pos)) != std::string::npos)
+    constexpr size_t npos{ static_cast<size_t>(-1) };
+    size_t t{ 0 }, n{ 0 };
+    size_t star_t{ npos }, star_n{ 0 };
+    while (n < len)
     {
-        source.replace(pos, 1, replacement);
-        pos += replacement.length();
+        if (t < m_tokens.size())
+        {
+            auto& tok = m_tokens[t];
+            auto c = static_cast<std::make_unsigned_t<Char>>(name[n]);
+            bool ok{ false };
+            switch (tok.op)
+            {
+            case Op::Star:
+                star_t = t++;
+                star_n = n;
+                continue;
+            case Op::Any:
+                ok = true;
+                break;
+            case Op::Char:
+                ok = c < 256 && ascii_lower(static_cast<unsigned char>(c)) == tok.value;
+                break;
+            case Op::Class:
+                ok = c < 256 && m_classes[tok.value][static_cast<unsigned char>(c)];
+                break;
+            }
+            if (ok)
+            {
+                t++;
+                n++;
+                continue;
+            }
+        }
+        if (star_t == npos)
+            return false;
+        t = star_t + 1;
+        n = ++star_n;
     }
+    while (t < m_tokens.size() && m_tokens[t].op == Op::Star)
+        t++;
+    return t == m_tokens.size();
+}
+
+bool Glob::match(std::string_view name) const noexcept
+{
+    return match_impl(name.data(), name.size());
 }
 
-std::string to_regex_expression(const std::string& path)
+#ifdef _WIN32
+bool Glob::match(std::wstring_view name) const noexcept
 {
-    std::string expression{ "^" + path };
-    replace_all(expression, '.', "\\.");
-    replace_all(expression, '*', ".*");
-    replace_all(expression, '?', "(.{1,1})");
-    // TODO replacement of [..]
-    return expression;
+    return match_impl(name.data(), name.size());
 }
+#endif // _WIN32
 
 namespace fs = std::filesystem;
 
-std::vector<fs::path> dir(const std::string& pattern)
+namespace
 {
 #ifdef _WIN32
-    const std::string wildcards{ "*?" };
+    constexpr const wchar_t* SEPARATORS{ L"\\/" };
+    const std::string WILDCARDS{ "*?" };
 #else
-    const std::string wildcards{ "*?[" };
+    constexpr const char* SEPARATORS{ "/" };
+    const std::string WILDCARDS{ "*?[" };
+#endif // _WIN32
+
+    bool match_filename(const Glob& glob, const fs::path& path, [[maybe_unused]] bool ascii)
+    // matches the filename in place in the native path string if the pattern is ASCII; ascii is only needed on Windows
+    {
+#ifdef _WIN32
+        // non ASCII chars of the pattern are in the ANSI codepage and can't be compared to the native wide chars
+        if (!ascii)
+            return glob.match(path.filename().string());
 #endif // _WIN32
+        const auto& native = path.native();
+        auto name = std::basic_string_view<fs::path::value_type>(native);
+        auto sep = native.find_last_of(SEPARATORS);
+        if (sep != fs::path::string_type::npos)
+            name.remove_prefix(sep + 1);
+        return glob.match(name);
+    }
 
-    std::vector<fs::path> result{};
-    if (pattern.find_first_of(wildcards) == std::string::npos)
+    /* Walks a directory tree to find the paths matching a list of steps.
+       A step is a filename pattern that matches an entry of the directory of the previous step,
+       or of any of its subdirectories if the step is recursive (** in the pattern).
+       Directories are scanned in parallel by a pool of threads that share a queue of (directory, step) tasks.
+       In streaming mode, each path is published as soon as it is found and consumed with the function next.
+    */
+    class Dir_Walker
     {
-        if (fs::exists(fs::path(pattern)))
-            result.push_back(pattern);
+    public:
+        Dir_Walker(const std::string& pattern, const std::vector<std::string>& excludes, unsigned int threads, bool streaming);
+
+        std::vector<fs::path> walk();
+        void run();
+        bool next(fs::path& path);
+        void stop();
+
+    private:
+        struct Step
+        {
+            bool recursive{ false };
+            Glob glob;
+        };
+        using Task = std::pair<fs::path, size_t>;
+
+        std::vector<Step> m_steps{};
+        std::vector<Glob> m_excludes{};
+        bool m_ascii{ true };
+        bool m_streaming{ false };
+        unsigned int m_threads{ 1 };
+
+        std::mutex m_mutex{};
+        std::condition_variable m_cv{};         // signals the tasks to the workers
+        std::condition_variable m_ready{};      // signals the results to the consumer
+        std::deque<Task> m_tasks{};
+        size_t m_active{ 0 };
+        bool m_done{ false };
+        std::atomic<bool> m_stop{ false };
+        std::exception_ptr m_error{};
+        std::deque<fs::path> m_result{};
+
+        bool excluded(const fs::path& path) const
+        {
+            return std::any_of(m_excludes.begin(), m_excludes.end(), [&](const Glob& g) { return match_filename(g, path, m_ascii); });
+        }
+
+        void publish(std::vector<fs::path>& found);
+        void scan(const Task& task, std::vector<fs::path>& found, std::vector<Task>& subtasks);
+        void worker();
+    };
+
+    Dir_Walker::Dir_Walker(const std::string& pattern, const std::vector<std::string>& excludes, unsigned int threads, bool streaming)
+        : m_streaming{ streaming }
+    {
+        if (pattern.find_first_of(WILDCARDS) == std::string::npos)
+        {
+            if (fs::exists(fs::path(pattern)))
+                m_result.push_back(pattern);
+            return;
+        }
+        std::string filename{ pattern };
+        while (!filename.empty() && (filename.back() == '\\' || filename.back() == '/'))
+            filename.pop_back();        // ending path separators are ignore
+        // the root directory is made of the components before the first one containing a wildcard
+        std::string directory{ "." };
+        auto itr = filename.find_last_of("/\\", filename.find_first_of(WILDCARDS));
+        if (itr != std::string::npos)
+        {
+            directory = filename.substr(0, itr);
+            if (directory.empty())
+                directory = filename.substr(0, 1);      // root of the filesystem
+            filename = filename.substr(itr + 1, filename.size());
+        }
+        if (!fs::exists(fs::path(directory)))
+            return;
+        const bool classes = WILDCARDS.find('[') != std::string::npos;
+        bool recursive{ false };
+        size_t pos{ 0 };
+        while (pos <= filename.size())
+        {
+            auto next = std::min(filename.find_first_of("/\\", pos), filename.size());
+            auto component = filename.substr(pos, next - pos);
+            pos = next + 1;
+            if (component == "**")
+                recursive = true;
+            else if (!component.empty())
+            {
+                m_steps.push_back(Step{ recursive, Glob(component, classes) });
+                recursive = false;
+            }
+        }
+        if (recursive)
+            m_steps.push_back(Step{ true, Glob("*", classes) });       // ending ** matches all the entries of the tree
+        for (auto& exclude : excludes)
+            m_excludes.emplace_back(exclude, classes);
+        auto is_ascii = [](const std::string& str) { return std::all_of(str.begin(), str.end(), [](unsigned char c) { return c < 0x80; }); };
+        m_ascii = is_ascii(filename) && std::all_of(excludes.begin(), excludes.end(), is_ascii);
+        m_threads = threads == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : threads;
+        if (m_steps.size() == 1 && !m_steps.front().recursive)
+            m_threads = 1;      // a single directory is scanned by one thread
+        m_tasks.emplace_back(directory, 0);
+    }
+
+    std::vector<fs::path> Dir_Walker::walk()
+    // walks the whole tree and returns the sorted result
+    {
+        run();
+        if (m_error)
+            std::rethrow_exception(m_error);
+        std::vector<fs::path> result(std::make_move_iterator(m_result.begin()), std::make_move_iterator(m_result.end()));
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());      // ** can find a path twice
         return result;
     }
-    std::string directory{ "." };
-    std::string filename{ pattern };
-    while (!filename.empty() && (filename.back() == '\\' || filename.back() == '/'))
-        filename.pop_back();        // ending path separators are ignore
-    auto itr = filename.find_last_of("/\\");
-    if (itr != std::string::npos)
+
+    void Dir_Walker::run()
+    // runs the workers up to the end of the walk, the calling thread being one of them
     {
-        directory = filename.substr(0, itr);
-        filename = filename.substr(itr + 1, filename.size());
+        std::vector<std::thread> pool{};
+        for (unsigned int i = 1; i < m_threads; i++)
+            pool.emplace_back(&Dir_Walker::worker, this);
+        worker();
+        for (auto& t : pool)
+            t.join();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = true;
+        m_ready.notify_all();
     }
-    if (directory.find_first_of(wildcards) != std::string::npos || !fs::exists(fs::path(directory)))
-        return result;          // wildcards are not allowed in parent path
-    std::regex expr(to_regex_expression(filename), std::regex_constants::icase);
-    for (auto it = fs::directory_iterator(directory); it != fs::directory_iterator(); ++it)
+
+    bool Dir_Walker::next(fs::path& path)
+    // waits for the next path published by run and returns false at the end of the walk
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_ready.wait(lock, [&] { return !m_result.empty() || m_done; });
+        if (!m_result.empty())
+        {
+            path = std::move(m_result.front());
+            m_result.pop_front();
+            return true;
+        }
+        if (m_error)
+            std::rethrow_exception(std::exchange(m_error, nullptr));
+        return false;
+    }
+
+    void Dir_Walker::stop()
     {
-        if (std::regex_match(it->path().filename().string(), expr))
-            result.push_back(it->path());
+        m_stop = true;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cv.notify_all();
     }
-    return result;
+
+    void Dir_Walker::publish(std::vector<fs::path>& found)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_result.insert(m_result.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+        found.clear();
+        m_ready.notify_one();
+    }
+
+    void Dir_Walker::scan(const Task& task, std::vector<fs::path>& found, std::vector<Task>& subtasks)
+    {
+        auto& step = m_steps[task.second];
+        bool last = task.second + 1 == m_steps.size();
+        for (auto& entry : fs::directory_iterator(task.first, fs::directory_options::skip_permission_denied))
+        {
+            if (m_stop)
+                return;
+            auto& path = entry.path();
+            if (excluded(path))
+                continue;
+            std::error_code ec;
+            bool directory = entry.is_directory(ec);
+            if (step.recursive && directory && !entry.is_symlink(ec))       // symbolic links are not followed to avoid loops
+                subtasks.emplace_back(path, task.second);
+            if (!match_filename(step.glob, path, m_ascii))
+                continue;
+            if (!last)
+            {
+                if (directory)
+                    subtasks.emplace_back(path, task.second + 1);
+                continue;
+            }
+            found.push_back(path);
+            if (m_streaming)
+                publish(found);
+        }
+    }
+
+    void Dir_Walker::worker()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_cv.wait(lock, [&] { return !m_tasks.empty() || m_active == 0 || m_error || m_stop; });
+            if (m_error || m_stop || m_tasks.empty())
+                return;
+            auto task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            m_active++;
+            lock.unlock();
+            std::vector<fs::path> found{};
+            std::vector<Task> subtasks{};
+            std::exception_ptr error{};
+            try
+            {
+                scan(task, found, subtasks);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            lock.lock();
+            if (error && !m_error)
+                m_error = error;
+            m_result.insert(m_result.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+            m_tasks.insert(m_tasks.end(), std::make_move_iterator(subtasks.begin()), std::make_move_iterator(subtasks.end()));
+            m_active--;
+            m_cv.notify_all();
+        }
+    }
+}
+
+std::vector<fs::path> dir(const std::string& pattern, const std::vector<std::string>& excludes, unsigned int threads)
+{
+    return Dir_Walker(pattern, excludes, threads, false).walk();
+}
+
+struct Dir_Reader::Impl
+{
+    Dir_Walker walker;
+    std::thread thread;
+
+    Impl(const std::string& pattern, const std::vector<std::string>& excludes, unsigned int threads)
+        : walker(pattern, excludes, threads, true)
+    {
+        thread = std::thread(&Dir_Walker::run, &walker);
+    }
+};
+
+Dir_Reader::Dir_Reader(const std::string& pattern, const std::vector<std::string>& excludes, unsigned int threads)
+    : m_impl{ std::make_unique<Impl>(pattern, excludes, threads) }
+{
+}
+
+Dir_Reader::~Dir_Reader()
+{
+    m_impl->walker.stop();
+    m_impl->thread.join();
+}
+
+bool Dir_Reader::next(fs::path& path)
+{
+    return m_impl->walker.next(path);
+}
+
+bool file_id(const fs::path& path, File_Id& id) noexcept
+{
+#ifdef _WIN32
+    // no access right is needed to query the file information, and directories need backup semantics
+    HANDLE h = CreateFileW(path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+        return false;
+    BY_HANDLE_FILE_INFORMATION info;
+    bool ok = GetFileInformationByHandle(h, &info) != 0;
+    CloseHandle(h);
+    if (!ok)
+        return false;
+    id.device = info.dwVolumeSerialNumber;
+    id.index = (static_cast<std::uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+    id.device = static_cast<std::uint64_t>(st.st_dev);
+    id.index = static_cast<std::uint64_t>(st.st_ino);
+#endif // _WIN32
+    return true;
+}
+
+bool File_Set::insert(const fs::path& path)
+{
+    File_Id id{};
+    if (file_id(path, id))
+        return m_ids.insert(id).second;
+    return m_paths.insert(path.lexically_normal().native()).second;
 }
 
 EOL find_EOL(const std::vector<char>& buf)
@@ -184,165 +772,1442 @@ std::string EOL_str(const EOL eol_type)
     }
 }
 
-std::vector<std::string> split(const std::string& s, const char delim)
+MappedFile::MappedFile(MappedFile&& other) noexcept
 {
-    std::vector<std::string> result;
-    std::istringstream iss(s);
-    std::string item;
-    while (std::getline(iss, item, delim))
-        result.push_back(item);
-    return result;
+    *this = std::move(other);
 }
 
-bool checkDate(int day, int month, int year)
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
 {
-    if (day < 1 || day > 31)
-        return false;
-    if (month < 1 || month > 12)
-        return false;
-    if ((month == 4 || month == 6 || month == 9 || month == 11) && day == 31)
-        return false;
-    if (month == 2)
+    if (this != &other)
     {
-        if (day == 30)
-            return false;
-        bool leap = (year % 4 == 0) && (year % 100 != 0) || (year % 400 == 0);
-        if (!leap && day == 29)
-            return false;
+        close();
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_open, other.m_open);
+#ifdef _WIN32
+        std::swap(m_file, other.m_file);
+        std::swap(m_mapping, other.m_mapping);
+#else
+        std::swap(m_fd, other.m_fd);
+#endif // _WIN32
     }
-    return true;
+    return *this;
 }
 
-strDateConverter::strDateConverter()
+void MappedFile::open(const std::filesystem::path& filepath)
 {
-    auto t = std::time(0);
-    std::tm now;
-    localtime_s(&now, &t);
-    century = now.tm_year / 100 + 19;
+    close();
+#ifdef _WIN32
+    auto error = [&filepath]() { return std::filesystem::filesystem_error("Unable to map the file.", filepath,
+        std::error_code(static_cast<int>(GetLastError()), std::system_category())); };
+    HANDLE file = CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        throw error();
+    m_file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        auto e = error();
+        close();
+        throw e;
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+    if (m_size > 0)
+    {
+        m_mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_mapping != NULL)
+            m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_data == nullptr)
+        {
+            auto e = error();
+            close();
+            throw e;
+        }
+    }
+#else
+    auto error = [&filepath]() { return std::filesystem::filesystem_error("Unable to map the file.", filepath,
+        std::error_code(errno, std::generic_category())); };
+    m_fd = ::open(filepath.c_str(), O_RDONLY);
+    if (m_fd < 0)
+        throw error();
+    struct stat st;
+    if (fstat(m_fd, &st) != 0)
+    {
+        auto e = error();
+        close();
+        throw e;
+    }
+    m_size = static_cast<size_t>(st.st_size);
+    if (m_size > 0)
+    {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (data == MAP_FAILED)
+        {
+            auto e = error();
+            close();
+            throw e;
+        }
+        madvise(data, m_size, MADV_SEQUENTIAL);     // only a hint, its failure is not an error
+        m_data = static_cast<const char*>(data);
+    }
+#endif // _WIN32
+    m_open = true;
 }
 
-bool strDateConverter::setToFmt(const std::string& fmt)
+void MappedFile::close() noexcept
 {
-    bool m_valid = m_fromValid && setFmt(fmt, m_toFmt, m_toDelim, m_toPos, m_toLen, m_toSep, m_toValid);
-    if (m_valid)
+#ifdef _WIN32
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr)
+        CloseHandle(m_mapping);
+    if (m_file != nullptr)
+        CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    if (m_data != nullptr)
+        munmap(const_cast<char*>(m_data), m_size);
+    if (m_fd >= 0)
+        ::close(m_fd);
+    m_fd = -1;
+#endif // _WIN32
+    m_data = nullptr;
+    m_size = 0;
+    m_open = false;
+}
+
+namespace
+{
+    void load(const std::filesystem::path& filepath, std::uintmax_t bytes)
+    // asks the system to load the beginning of the file in its cache
     {
-        // defines the order of converted components based on their position in the format
-        m_toOrder = { YEAR_COMP, MONTH_COMP, DAY_COMP };
-        for (unsigned char i = 0; i < 2; i++)
-            for (unsigned char j = i + 1; j < 3; j++)
-                if (m_toPos[m_toOrder[j]] < m_toPos[m_toOrder[i]])
-                    std::swap(m_toOrder[i], m_toOrder[j]);
+#ifdef _WIN32
+        // the cache is filled by reads into a scratch buffer, the sequential scan hint makes the system read ahead
+        HANDLE file = CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+        constexpr DWORD BLOCK_SIZE{ 1 << 20 };
+        std::vector<char> buf(BLOCK_SIZE);
+        DWORD read{ 0 };
+        while (bytes > 0 && ReadFile(file, buf.data(), static_cast<DWORD>(std::min<std::uintmax_t>(bytes, BLOCK_SIZE)), &read, NULL) && read > 0)
+            bytes -= std::min<std::uintmax_t>(bytes, read);
+        CloseHandle(file);
+#else
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        // a length of 0 means up to the end of the file
+        off_t len = bytes >= static_cast<std::uintmax_t>(std::numeric_limits<off_t>::max()) ? 0 : static_cast<off_t>(bytes);
+        posix_fadvise(fd, 0, len, POSIX_FADV_WILLNEED);
+        ::close(fd);
+#endif // _WIN32
     }
-    return m_valid;
 }
 
-unsigned char strDateConverter::isValid(const unsigned char mode)
+Prefetcher::Prefetcher()
+    : m_thread{ &Prefetcher::run, this }
 {
-    unsigned char result = NONE;
-    if (m_fromValid && (mode & FROM) == FROM)
-        result = result | FROM;
-    if (m_toValid && (mode & TO) == TO)
-        result = result | TO;
-    return result;
 }
 
-bool strDateConverter::checkStrDate(const std::string& str)
+Prefetcher::~Prefetcher()
 {
-    if (!m_fromValid)
-        return false;
-    auto date = trimc(str);
-    if (date.length() > m_fromFmt.length() + 5)
-        return false;
-    std::array<unsigned long, 3> compvals;
-    compvals.fill(0);
-    if (m_fromDelim)
     {
-        std::vector<std::string> comps = split(date, m_fromSep);
-        if (comps.size() != 3)
-            return false;
-        for (size_t i = 0; i < 3; i++)
-        {
-            auto comp = m_fromPos[i];
-            size_t proc;
-            try
-            {
-                compvals[i] = stoul(comps[comp], &proc);
-            }
-            catch (...)
-            {
-                return false;
-            }
-            if (compvals[i] < 0)
-                return false;
-            if ((m_fromLen[i] == 2 || m_fromLen[i] == 4) && proc != m_fromLen[i])
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_requests.clear();
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+void Prefetcher::prefetch(const std::filesystem::path& filepath, std::uintmax_t bytes)
+{
+    if (bytes == 0)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requests.emplace_back(filepath, bytes);
+    m_cv.notify_all();
+}
+
+void Prefetcher::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_requests.empty() && !m_busy; });
+}
+
+void Prefetcher::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_cv.wait(lock, [this] { return m_stop || !m_requests.empty(); });
+        if (m_stop)
+            return;
+        auto request = std::move(m_requests.front());
+        m_requests.pop_front();
+        m_busy = true;
+        lock.unlock();
+        load(request.first, request.second);
+        lock.lock();
+        m_busy = false;
+        m_cv.notify_all();
+    }
+}
+
+LineReader::LineReader(const std::filesystem::path& filepath, EOL eol, size_t bufsize)
+    : m_path(filepath), m_in(filepath, std::ios_base::binary | std::ios_base::in), m_eol(eol), m_buf(std::max(bufsize, static_cast<size_t>(16)))
+{
+    if (!m_in.is_open())
+        throw std::filesystem::filesystem_error("Unable to open the file.", filepath, std::make_error_code(std::errc::no_such_file_or_directory));
+    if (m_eol == EOL::Unknown)
+        m_eol = file_EOL(filepath);
+    m_last = m_eol == EOL::Mac ? '\r' : '\n';      // CR+LF sequences end with LF
+}
+
+bool LineReader::fill()
+{
+    if (m_eof)
+        return false;
+    if (m_pos > 0)
+    {
+        // moves the incomplete line at the begin of the buffer
+        std::memmove(m_buf.data(), m_buf.data() + m_pos, m_end - m_pos);
+        m_scan -= m_pos;
+        m_end -= m_pos;
+        m_pos = 0;
+    }
+    else if (m_end == m_buf.size())
+        m_buf.resize(m_buf.size() * 2);             // the line is longer than the buffer
+    m_in.read(m_buf.data() + m_end, static_cast<std::streamsize>(m_buf.size() - m_end));
+    if (m_in.bad())
+        throw std::filesystem::filesystem_error("Unable to read the file.", m_path, std::make_error_code(std::errc::io_error));
+    m_end += static_cast<size_t>(m_in.gcount());
+    m_eof = m_in.eof();
+    return true;
+}
+
+bool LineReader::getline(std::string_view& line)
+{
+    while (true)
+    {
+        auto found = static_cast<const char*>(std::memchr(m_buf.data() + m_scan, m_last, m_end - m_scan));
+        if (found != nullptr)
+        {
+            size_t len = found - (m_buf.data() + m_pos);
+            if (m_eol == EOL::Windows && len > 0 && found[-1] == '\r')
+                len--;
+            line = std::string_view(m_buf.data() + m_pos, len);
+            m_pos = m_scan = found - m_buf.data() + 1;
+            m_lines++;
+            return true;
+        }
+        m_scan = m_end;
+        if (!fill())
+        {
+            if (m_pos == m_end)
                 return false;
+            line = std::string_view(m_buf.data() + m_pos, m_end - m_pos);     // last line without EOL
+            m_pos = m_scan = m_end;
+            m_lines++;
+            return true;
+        }
+    }
+}
+
+namespace
+{
+    const size_t BLOCK_ALIGNMENT{ 4096 };
+}
+
+void OutputWriter::Block_Deleter::operator()(char* block) const noexcept
+{
+    ::operator delete(block, std::align_val_t(BLOCK_ALIGNMENT));
+}
+
+OutputWriter::OutputWriter(const std::filesystem::path& filepath, EOL eol, bool background, size_t blocksize)
+    : m_path(filepath), m_eol(EOL_str(eol)), m_background(background)
+{
+    m_blocksize = std::max((blocksize + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT, static_cast<size_t>(1)) * BLOCK_ALIGNMENT;
+    auto new_block = [this]() { return Block(static_cast<char*>(::operator new(m_blocksize, std::align_val_t(BLOCK_ALIGNMENT)))); };
+#ifdef _WIN32
+    if (_wfopen_s(&m_file, filepath.c_str(), L"wb") != 0)
+        m_file = nullptr;
+#else
+    m_file = std::fopen(filepath.c_str(), "wb");
+#endif // _WIN32
+    if (m_file == nullptr)
+        throw std::filesystem::filesystem_error("Unable to create the file.", filepath, std::make_error_code(std::errc::io_error));
+    std::setvbuf(m_file, nullptr, _IONBF, 0);         // blocks are passed directly to the system
+    m_block = new_block();
+    if (m_background)
+    {
+        // one block is filled while up to two blocks are written
+        m_free.push_back(new_block());
+        m_free.push_back(new_block());
+        m_thread = std::thread(&OutputWriter::background_writes, this);
+    }
+}
+
+OutputWriter::~OutputWriter()
+{
+    try {
+        close(); }
+    catch (...) {}
+}
+
+void OutputWriter::write(std::string_view data)
+{
+    if (m_eol.empty())
+        return append(data.data(), data.size());
+    auto p = data.data();
+    auto end = p + data.size();
+    if (m_cr && p != end && *p == '\n')
+        p++;                                        // LF of a CR+LF sequence split between two writes
+    m_cr = false;
+    while (p != end)
+    {
+        auto eol = std::find_if(p, end, [](char c) { return c == '\r' || c == '\n'; });
+        append(p, eol - p);
+        if (eol == end)
+            break;
+        append(m_eol.data(), m_eol.size());
+        p = eol + 1;
+        if (*eol == '\r')
+        {
+            if (p == end)
+                m_cr = true;
+            else if (*p == '\n')
+                p++;
         }
     }
+}
+
+void OutputWriter::write_line(std::string_view line)
+{
+    write(line);
+    m_cr = false;
+    if (!m_eol.empty())
+        append(m_eol.data(), m_eol.size());
     else
+#ifdef _WIN32
+        append("\r\n", 2);
+#else
+        append("\n", 1);
+#endif // _WIN32
+}
+
+void OutputWriter::append(const char* data, size_t len)
+{
+    while (len > 0)
     {
-        for (size_t i = 0; i < 3; i++)
+        auto n = std::min(len, m_blocksize - m_used);
+        std::memcpy(m_block.get() + m_used, data, n);
+        m_used += n;
+        data += n;
+        len -= n;
+        if (m_used == m_blocksize)
+            submit();
+    }
+}
+
+void OutputWriter::submit()
+{
+    if (!m_background)
+        write_block(m_block.get(), m_used);
+    else
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_pending.emplace_back(std::move(m_block), m_used);
+        m_cv.notify_all();
+        m_cv.wait(lock, [this]() { return !m_free.empty(); });
+        m_block = std::move(m_free.back());
+        m_free.pop_back();
+        lock.unlock();
+        check_error();
+    }
+    m_written += m_used;
+    m_used = 0;
+}
+
+void OutputWriter::write_block(const char* data, size_t len)
+{
+    if (len > 0 && std::fwrite(data, 1, len, m_file) != len)
+        throw std::filesystem::filesystem_error("Unable to write the file.", m_path, std::make_error_code(std::errc::io_error));
+}
+
+void OutputWriter::background_writes()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_cv.wait(lock, [this]() { return !m_pending.empty() || m_stop; });
+        if (m_pending.empty())
+            break;
+        auto block = std::move(m_pending.front());
+        m_pending.pop_front();
+        m_inflight++;
+        // m_error is shared with the producer, so it is only read and set under the lock
+        bool failed = m_error != nullptr;
+        lock.unlock();
+        std::exception_ptr error{};
+        if (!failed)
         {
-            auto comp = date.substr(m_fromPos[i], m_fromLen[i]);
-            size_t proc;
-            try
-            {
-                compvals[i] = stoul(comp, &proc);
-            }
-            catch (...)
-            {
-                return false;
-            }
-            if (compvals[i] < 0)
+            try {
+                write_block(block.first.get(), block.second); }
+            catch (...) {
+                error = std::current_exception(); }
+        }
+        lock.lock();
+        if (error && !m_error)
+            m_error = error;
+        m_inflight--;
+        m_free.push_back(std::move(block.first));
+        m_cv.notify_all();
+    }
+}
+
+void OutputWriter::check_error()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_error)
+        std::rethrow_exception(std::exchange(m_error, nullptr));
+}
+
+void OutputWriter::flush()
+{
+    if (m_file == nullptr)
+        return;
+    if (m_used > 0)
+        submit();
+    if (m_background)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return m_pending.empty() && m_inflight == 0; });
+        lock.unlock();
+        check_error();
+    }
+}
+
+void OutputWriter::close()
+{
+    if (m_file == nullptr)
+        return;
+    std::exception_ptr error{};
+    try {
+        flush(); }
+    catch (...) {
+        error = std::current_exception(); }
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+    if (std::fclose(m_file) != 0 && !error)
+        error = std::make_exception_ptr(std::filesystem::filesystem_error("Unable to close the file.", m_path, std::make_error_code(std::errc::io_error)));
+    m_file = nullptr;
+    if (error)
+        std::rethrow_exception(error);
+}
+
+#ifdef UTILS_IO_URING
+// A ring of io_uring with one read in flight at most per slot of the buffer of the reader.
+// The completions can arrive in any order, they are stored by slot until the reader asks for the block of the slot.
+struct Block_Reader::Uring
+{
+    int fd{ -1 };
+    void* sq_ring{ MAP_FAILED };
+    size_t sq_len{ 0 };
+    void* cq_ring{ MAP_FAILED };
+    size_t cq_len{ 0 };
+    io_uring_sqe* sqes{ nullptr };
+    size_t sqes_len{ 0 };
+    unsigned* sq_tail{ nullptr };
+    unsigned* sq_mask{ nullptr };
+    unsigned* sq_array{ nullptr };
+    unsigned* cq_head{ nullptr };
+    unsigned* cq_tail{ nullptr };
+    unsigned* cq_mask{ nullptr };
+    io_uring_cqe* cqes{ nullptr };
+    bool fixed{ false };                    // the buffers are registered
+    std::vector<iovec> requests{};          // buffer and length of the read of each slot
+    std::vector<int> results{};
+    std::vector<bool> done{};
+    size_t inflight{ 0 };
+    std::uintmax_t next{ 0 };               // offset of the next block to submit
+    size_t current{ NO_SLOT };              // slot of the block returned by the last read
+
+    static constexpr size_t NO_SLOT{ static_cast<size_t>(-1) };
+
+    ~Uring()
+    {
+        // the reads in flight are completed before the buffers are released
+        while (inflight > 0 && complete())
+            ;
+        if (sqes != nullptr)
+            munmap(sqes, sqes_len);
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+            munmap(cq_ring, cq_len);
+        if (sq_ring != MAP_FAILED)
+            munmap(sq_ring, sq_len);
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    bool setup(char* buffer, size_t blocksize, size_t depth)
+    {
+        io_uring_params params{};
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(depth), &params));
+        if (fd < 0)
+            return false;
+        sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+            sq_len = cq_len = std::max(sq_len, cq_len);
+        sq_ring = mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ring == MAP_FAILED)
+            return false;
+        cq_ring = single ? sq_ring : mmap(nullptr, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED)
+            return false;
+        sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+        void* entries = mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (entries == MAP_FAILED)
+            return false;
+        sqes = static_cast<io_uring_sqe*>(entries);
+        auto sq = static_cast<char*>(sq_ring);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        auto cq = static_cast<char*>(cq_ring);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        for (size_t i = 0; i < depth; i++)
+            requests.push_back(iovec{ buffer + i * blocksize, blocksize });
+        results.assign(depth, 0);
+        done.assign(depth, false);
+        // registered buffers avoid the mapping of the pages at each read, they are limited by RLIMIT_MEMLOCK
+        fixed = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, requests.data(), static_cast<unsigned>(depth)) == 0;
+        return true;
+    }
+
+    bool submit(size_t slot, int file, std::uintmax_t offset, size_t len)
+    {
+        unsigned tail = *sq_tail;
+        unsigned index = tail & *sq_mask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        requests[slot].iov_len = len;
+        sqe.fd = file;
+        sqe.off = offset;
+        sqe.user_data = slot;
+        if (fixed)
+        {
+            sqe.opcode = IORING_OP_READ_FIXED;
+            sqe.addr = reinterpret_cast<std::uint64_t>(requests[slot].iov_base);
+            sqe.len = static_cast<std::uint32_t>(len);
+            sqe.buf_index = static_cast<std::uint16_t>(slot);
+        }
+        else
+        {
+            sqe.opcode = IORING_OP_READV;
+            sqe.addr = reinterpret_cast<std::uint64_t>(&requests[slot]);
+            sqe.len = 1;
+        }
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        int ret;
+        while ((ret = static_cast<int>(syscall(__NR_io_uring_enter, fd, 1, 0, 0, nullptr, 0))) < 0 && errno == EINTR)
+            ;
+        if (ret < 1)
+        {
+            __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+            return false;
+        }
+        done[slot] = false;
+        inflight++;
+        return true;
+    }
+
+    bool complete()
+    // waits for a completion and stores its result
+    {
+        unsigned head = *cq_head;
+        while (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+        {
+            if (syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
                 return false;
-            if ((m_fromLen[i] == 2 || m_fromLen[i] == 4) && proc != m_fromLen[i])
+        }
+        auto& cqe = cqes[head & *cq_mask];
+        auto slot = static_cast<size_t>(cqe.user_data);
+        results[slot] = cqe.res;
+        done[slot] = true;
+        inflight--;
+        __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+};
+#else
+struct Block_Reader::Uring
+{
+};
+#endif // UTILS_IO_URING
+
+void Block_Reader::Buffer_Deleter::operator()(char* buffer) const noexcept
+{
+    ::operator delete(buffer, std::align_val_t(BLOCK_ALIGNMENT));
+}
+
+Block_Reader::Block_Reader(const std::filesystem::path& filepath, IO_Backend backend, size_t blocksize, size_t depth)
+    : m_path(filepath)
+{
+    m_blocksize = std::max((blocksize + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT, static_cast<size_t>(1)) * BLOCK_ALIGNMENT;
+    depth = std::max(depth, static_cast<size_t>(1));
+#ifdef _WIN32
+    auto error = [&filepath]() { return std::filesystem::filesystem_error("Unable to open the file.", filepath,
+        std::error_code(static_cast<int>(GetLastError()), std::system_category())); };
+    HANDLE file = CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        throw error();
+    m_file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        auto e = error();
+        CloseHandle(file);
+        throw e;
+    }
+    m_size = static_cast<std::uintmax_t>(size.QuadPart);
+#else
+    auto error = [&filepath]() { return std::filesystem::filesystem_error("Unable to open the file.", filepath,
+        std::error_code(errno, std::generic_category())); };
+    m_fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0)
+        throw error();
+    struct stat st;
+    if (fstat(m_fd, &st) != 0)
+    {
+        auto e = error();
+        ::close(m_fd);
+        throw e;
+    }
+    m_size = static_cast<std::uintmax_t>(st.st_size);
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);       // only a hint, its failure is not an error
+#endif // _WIN32
+    size_t nbuffers{ 1 };
+#ifdef UTILS_IO_URING
+    if (backend == IO_Backend::Uring && m_size > 0)
+        nbuffers = depth;
+#endif // UTILS_IO_URING
+    m_buffer.reset(static_cast<char*>(::operator new(nbuffers * m_blocksize, std::align_val_t(BLOCK_ALIGNMENT))));
+#ifdef UTILS_IO_URING
+    if (nbuffers > 1)
+    {
+        auto uring = std::make_unique<Uring>();
+        bool ok = uring->setup(m_buffer.get(), m_blocksize, depth);
+        for (size_t slot = 0; ok && slot < depth && uring->next < m_size; slot++)
+        {
+            ok = uring->submit(slot, m_fd, uring->next, static_cast<size_t>(std::min<std::uintmax_t>(m_blocksize, m_size - uring->next)));
+            uring->next += m_blocksize;
+        }
+        if (ok)
+            m_uring = std::move(uring);     // otherwise falls back to the blocking reads
+    }
+#else
+    (void)backend;
+#endif // UTILS_IO_URING
+}
+
+Block_Reader::~Block_Reader()
+{
+    m_uring.reset();
+#ifdef _WIN32
+    CloseHandle(m_file);
+#else
+    ::close(m_fd);
+#endif // _WIN32
+}
+
+size_t Block_Reader::read_at(char* data, size_t len, std::uintmax_t offset)
+{
+    size_t total{ 0 };
+    while (total < len)
+    {
+#ifdef _WIN32
+        OVERLAPPED ov{};
+        ov.Offset = static_cast<DWORD>(offset + total);
+        ov.OffsetHigh = static_cast<DWORD>((offset + total) >> 32);
+        DWORD count{ 0 };
+        if (!ReadFile(m_file, data + total, static_cast<DWORD>(len - total), &count, &ov))
+        {
+            if (GetLastError() == ERROR_HANDLE_EOF)
+                break;
+            throw std::filesystem::filesystem_error("Unable to read the file.", m_path,
+                std::error_code(static_cast<int>(GetLastError()), std::system_category()));
+        }
+#else
+        auto count = pread(m_fd, data + total, len - total, static_cast<off_t>(offset + total));
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::filesystem::filesystem_error("Unable to read the file.", m_path, std::error_code(errno, std::generic_category()));
+        }
+#endif // _WIN32
+        if (count == 0)
+            break;
+        total += static_cast<size_t>(count);
+    }
+    return total;
+}
+
+bool Block_Reader::read(std::string_view& block)
+{
+    block = std::string_view{};
+#ifdef UTILS_IO_URING
+    if (m_uring)
+    {
+        auto& u = *m_uring;
+        if (u.current != Uring::NO_SLOT && u.next < m_size)
+        {
+            // the slot of the previous block is now free for the block that follows the ones in flight
+            if (!u.submit(u.current, m_fd, u.next, static_cast<size_t>(std::min<std::uintmax_t>(m_blocksize, m_size - u.next))))
+                throw std::filesystem::filesystem_error("Unable to read the file.", m_path, std::error_code(errno, std::generic_category()));
+            u.next += m_blocksize;
+        }
+        u.current = Uring::NO_SLOT;
+        if (m_offset >= m_size)
+            return false;
+        size_t slot = static_cast<size_t>(m_offset / m_blocksize % u.requests.size());
+        while (!u.done[slot])
+            if (!u.complete())
+                throw std::filesystem::filesystem_error("Unable to read the file.", m_path, std::error_code(errno, std::generic_category()));
+        if (u.results[slot] < 0)
+            throw std::filesystem::filesystem_error("Unable to read the file.", m_path, std::error_code(-u.results[slot], std::generic_category()));
+        auto data = static_cast<char*>(u.requests[slot].iov_base);
+        auto len = u.requests[slot].iov_len;
+        auto got = static_cast<size_t>(u.results[slot]);
+        if (got < len)
+            got += read_at(data + got, len - got, m_offset + got);      // short read
+        u.current = slot;
+        m_offset += m_blocksize;
+        if (got == 0)
+            return false;
+        block = std::string_view(data, got);
+        return true;
+    }
+#endif // UTILS_IO_URING
+    auto got = read_at(m_buffer.get(), m_blocksize, m_offset);
+    m_offset += got;
+    if (got == 0)
+        return false;
+    block = std::string_view(m_buffer.get(), got);
+    return true;
+}
+
+size_t Block_Reader::read(char* buffer)
+{
+#ifdef UTILS_IO_URING
+    if (m_uring)
+    {
+        std::string_view block{};
+        if (!read(block))
+            return 0;
+        std::memcpy(buffer, block.data(), block.size());
+        return block.size();
+    }
+#endif // UTILS_IO_URING
+    auto got = read_at(buffer, m_blocksize, m_offset);
+    m_offset += got;
+    return got;
+}
+
+namespace
+{
+    inline unsigned int trailing_zeros(std::uint64_t x) noexcept
+    // x must not be 0
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return static_cast<unsigned int>(index);
+#elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanForward(&index, static_cast<unsigned long>(x)))
+            return static_cast<unsigned int>(index);
+        _BitScanForward(&index, static_cast<unsigned long>(x >> 32));
+        return static_cast<unsigned int>(index) + 32;
+#else
+        return static_cast<unsigned int>(__builtin_ctzll(x));
+#endif // _MSC_VER
+    }
+
+    inline bool is_space(unsigned char c) noexcept
+    {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+#ifdef UTILS_SSE2
+    inline unsigned int space_mask(const char* p) noexcept
+    // sets the bits of the spaces of the 16 chars at p
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i blank = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+        // \t to \r are the chars from 9 to 13: the signed comparisons are false for the chars >= 0x80
+        __m128i control = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('\t' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('\r' + 1)));
+        return static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(blank, control)));
+    }
+#endif // UTILS_SSE2
+}
+
+std::string_view ltrimv(std::string_view s) noexcept
+{
+    size_t i{ 0 };
+#ifdef UTILS_SSE2
+    for (; i + 16 <= s.size(); i += 16)
+    {
+        auto mask = space_mask(s.data() + i);
+        if (mask != 0xFFFF)
+            return s.substr(i + trailing_zeros(~mask & 0xFFFF));
+    }
+#endif // UTILS_SSE2
+    while (i < s.size() && is_space(static_cast<unsigned char>(s[i])))
+        i++;
+    return s.substr(i);
+}
+
+std::string_view rtrimv(std::string_view s) noexcept
+{
+    size_t n{ s.size() };
+#ifdef UTILS_SSE2
+    for (; n >= 16; n -= 16)
+    {
+        auto mask = space_mask(s.data() + n - 16);
+        if (mask != 0xFFFF)
+        {
+            // the highest bit of the non spaces is the last one
+            auto last = ~mask & 0xFFFF;
+            unsigned int high{ 15 };
+            while ((last >> high) == 0)
+                high--;
+            return s.substr(0, n - 16 + high + 1);
+        }
+    }
+#endif // UTILS_SSE2
+    while (n > 0 && is_space(static_cast<unsigned char>(s[n - 1])))
+        n--;
+    return s.substr(0, n);
+}
+
+std::vector<std::string> split(const std::string& s, const char delim)
+{
+    std::vector<std::string> result;
+    Splitter splitter(s, delim);
+    std::string_view field{};
+    while (splitter.next(field))
+        result.emplace_back(field);
+    if (!result.empty() && result.back().empty())
+        result.pop_back();      // std::getline semantics
+    return result;
+}
+
+namespace
+{
+    // splits str in exactly 3 fields, returns false if the number of fields is different
+    bool split3(std::string_view str, char delim, std::array<std::string_view, 3>& fields) noexcept
+    {
+        Splitter splitter(str, delim);
+        std::string_view field{};
+        size_t count{ 0 };
+        while (splitter.next(field))
+        {
+            if (count == 3)
                 return false;
+            fields[count++] = field;
         }
+        return count == 3;
     }
-    if (m_fromLen[YEAR_COMP] == 2)
-        compvals[YEAR_COMP] += century;
-    return checkDate(compvals[DAY_COMP], compvals[MONTH_COMP], compvals[YEAR_COMP]);
 }
 
-std::string strDateConverter::convStrDate(const std::string& date)
+std::string unquote(std::string_view str, char quote)
 {
+    if (str.empty() || str.front() != quote)
+        return std::string(str);
+    str.remove_prefix(1);
+    if (!str.empty() && str.back() == quote)
+        str.remove_suffix(1);
     std::string result{};
-    std::vector<std::string> comps{};
-    if (m_fromDelim)
+    result.reserve(str.size());
+    for (size_t i = 0; i < str.size(); i++)
     {
-        auto comps2 = split(date, m_fromSep);
-        if (comps2.size() != 3)
-            return result;
-        for (unsigned char i = 0; i < 3; i++)
+        result += str[i];
+        if (str[i] == quote && i + 1 < str.size() && str[i + 1] == quote)
+            i++;        // doubled quote
+    }
+    return result;
+}
+
+namespace
+{
+    inline std::uint64_t prefix_xor(std::uint64_t x) noexcept
+    // bit i of the result is the XOR of the bits 0 to i of x
+    {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+    inline void block_masks(const char* block, char delim, char quote, std::uint64_t& delims, std::uint64_t& quotes) noexcept
+    // sets the bits of the chars of the 64 bytes block that are delimiters or quotes
+    {
+#if defined(UTILS_AVX2)
+        const __m256i d = _mm256_set1_epi8(delim);
+        const __m256i q = _mm256_set1_epi8(quote);
+        delims = quotes = 0;
+        for (int i = 0; i < 2; i++)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i));
+            delims |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, d)))) << (32 * i);
+            quotes |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, q)))) << (32 * i);
+        }
+#elif defined(UTILS_SSE2)
+        const __m128i d = _mm_set1_epi8(delim);
+        const __m128i q = _mm_set1_epi8(quote);
+        delims = quotes = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+            delims |= static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, d))) << (16 * i);
+            quotes |= static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, q))) << (16 * i);
+        }
+#else
+        delims = quotes = 0;
+        for (int i = 0; i < 64; i++)
         {
-            auto comp = comps2[m_fromPos[i]];
-            comps.push_back(comp);
+            delims |= static_cast<std::uint64_t>(block[i] == delim) << i;
+            quotes |= static_cast<std::uint64_t>(block[i] == quote) << i;
         }
+#endif
     }
-    else
+}
+
+size_t Delimited_Parser::parse(std::string_view record, std::vector<Field_Span>& fields) const
+{
+    fields.clear();
+    auto add = [&](size_t start, size_t end)
     {
-        for (unsigned char i = 0; i < 3; i++)
+        fields.push_back(Field_Span{ start, end - start, end > start && record[start] == m_quote });
+    };
+    size_t start{ 0 };
+    std::uint64_t inside{ 0 };         // all ones if the previous block ends inside quotes
+    char tail[64];
+    for (size_t base = 0; base < record.size(); base += 64)
+    {
+        size_t len = std::min(record.size() - base, static_cast<size_t>(64));
+        const char* block = record.data() + base;
+        if (len < 64)
         {
-            if (date.length() > m_fromPos[i])
-            {
-                auto comp = date.substr(m_fromPos[i], m_fromLen[i]);
-                comps.push_back(comp);
-            }
+            std::memset(tail, 0, sizeof(tail));
+            std::memcpy(tail, block, len);
+            block = tail;
+        }
+        std::uint64_t delims, quotes;
+        block_masks(block, m_delim, m_quote, delims, quotes);
+        if (len < 64)
+        {
+            std::uint64_t valid = (static_cast<std::uint64_t>(1) << len) - 1;
+            delims &= valid;
+            quotes &= valid;
         }
-        if (comps.size() != 3)
+        // a doubled quote closes and reopens the quoted region, so it needs no special case
+        std::uint64_t quoted = prefix_xor(quotes) ^ inside;
+        inside = static_cast<std::uint64_t>(0) - (quoted >> 63);
+        delims &= ~quoted;
+        while (delims != 0)
+        {
+            size_t pos = base + trailing_zeros(delims);
+            add(start, pos);
+            start = pos + 1;
+            delims &= delims - 1;
+        }
+    }
+    add(start, record.size());
+    return fields.size();
+}
+
+std::string_view Delimited_Parser::value(std::string_view record, const Field_Span& field, std::string& buffer) const
+{
+    auto raw = record.substr(field.offset, field.length);
+    if (!field.quoted)
+        return raw;
+    raw.remove_prefix(1);
+    if (!raw.empty() && raw.back() == m_quote)
+        raw.remove_suffix(1);
+    if (raw.find(m_quote) == std::string_view::npos)
+        return raw;
+    buffer.clear();
+    for (size_t i = 0; i < raw.size(); i++)
+    {
+        buffer += raw[i];
+        if (raw[i] == m_quote && i + 1 < raw.size() && raw[i + 1] == m_quote)
+            i++;        // doubled quote
+    }
+    return buffer;
+}
+
+bool checkDate(int day, int month, int year)
+{
+    if (day < 1 || day > 31)
+        return false;
+    if (month < 1 || month > 12)
+        return false;
+    if ((month == 4 || month == 6 || month == 9 || month == 11) && day == 31)
+        return false;
+    if (month == 2)
+    {
+        if (day > 29)
+            return false;
+        bool leap = (year % 4 == 0) && (year % 100 != 0) || (year % 400 == 0);
+        if (!leap && day == 29)
+            return false;
+    }
+    return true;
+}
+
+namespace
+{
+    struct Fixed_Date_Converter
+    {
+        const char* from;
+        const char* to;
+        size_t size;
+        bool (*check)(std::string_view, unsigned int) noexcept;
+        size_t (*conv)(std::string_view, char*, unsigned int) noexcept;
+    };
+
+    template <const char* From, const char* To>
+    constexpr Fixed_Date_Converter fixed_converter() noexcept
+    {
+        using Conv = fixedDateConverter<From, To>;
+        return { From, To, Conv::from.size, &Conv::checkStrDate, &Conv::convStrDate };
+    }
+
+    // the SAP user date formats from and to the internal format
+    constexpr std::array<Fixed_Date_Converter, 12> FIXED_DATE_CONVERTERS{ {
+        fixed_converter<date_formats::DDMMYYYY_DOT, date_formats::YYYYMMDD>(),
+        fixed_converter<date_formats::MMDDYYYY_SLASH, date_formats::YYYYMMDD>(),
+        fixed_converter<date_formats::MMDDYYYY_DASH, date_formats::YYYYMMDD>(),
+        fixed_converter<date_formats::YYYYMMDD_DOT, date_formats::YYYYMMDD>(),
+        fixed_converter<date_formats::YYYYMMDD_SLASH, date_formats::YYYYMMDD>(),
+        fixed_converter<date_formats::YYYYMMDD_DASH, date_formats::YYYYMMDD>(),
+        fixed_converter<date_formats::YYYYMMDD, date_formats::DDMMYYYY_DOT>(),
+        fixed_converter<date_formats::YYYYMMDD, date_formats::MMDDYYYY_SLASH>(),
+        fixed_converter<date_formats::YYYYMMDD, date_formats::MMDDYYYY_DASH>(),
+        fixed_converter<date_formats::YYYYMMDD, date_formats::YYYYMMDD_DOT>(),
+        fixed_converter<date_formats::YYYYMMDD, date_formats::YYYYMMDD_SLASH>(),
+        fixed_converter<date_formats::YYYYMMDD, date_formats::YYYYMMDD_DASH>()
+    } };
+
+    const std::array<std::uint32_t, 13>& day_masks()
+    // the bit d of the mask of a month is set if the day d is valid in a leap year, as said by checkDate
+    {
+        static const auto masks = []
+        {
+            std::array<std::uint32_t, 13> result{};
+            for (int month = 1; month <= 12; month++)
+                for (int day = 1; day <= 31; day++)
+                    if (checkDate(day, month, 2000))
+                        result[month] |= static_cast<std::uint32_t>(1) << day;
             return result;
+        }();
+        return masks;
+    }
+
+    struct Date_Pattern
+    // a row matches when, for each byte, (row ^ expected) <= limit that is 9 for digits and 0 for separators and the padding bytes
+    {
+        alignas(16) unsigned char expected[16]{};
+        alignas(16) unsigned char add[16]{};        // 0x7F - limit, so that the sum overflows into the high bit if greater than limit
+    };
+
+    Date_Pattern date_pattern(const char* fmt, const Date_Layout& layout) noexcept
+    {
+        Date_Pattern pattern{};
+        for (size_t i = 0; i < 16; i++)
+        {
+            bool digit = i < layout.size && (fmt[i] == 'd' || fmt[i] == 'm' || fmt[i] == 'y');
+            pattern.expected[i] = i >= layout.size ? 0 : digit ? '0' : static_cast<unsigned char>(fmt[i]);
+            pattern.add[i] = digit ? 0x76 : 0x7F;
+        }
+        return pattern;
+    }
+
+    inline bool match_pattern(const unsigned char* row, const Date_Pattern& pattern) noexcept
+    // checks the 16 bytes of the zero padded row, a byte with the high bit set being always rejected
+    {
+#if defined(UTILS_SSE2)
+        __m128i x = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row)), _mm_load_si128(reinterpret_cast<const __m128i*>(pattern.expected)));
+        __m128i bad = _mm_or_si128(_mm_add_epi8(x, _mm_load_si128(reinterpret_cast<const __m128i*>(pattern.add))), x);
+        return _mm_movemask_epi8(bad) == 0;
+#else
+        std::uint64_t bad{ 0 };
+        for (size_t i = 0; i < 16; i += 8)
+        {
+            std::uint64_t r, e, a;
+            std::memcpy(&r, row + i, 8);
+            std::memcpy(&e, pattern.expected + i, 8);
+            std::memcpy(&a, pattern.add + i, 8);
+            std::uint64_t x = r ^ e;
+            // no carry crosses bytes as long as x has no high bit, and a byte with the high bit is rejected anyway
+            bad |= (x + a) | x;
+        }
+        return (bad & 0x8080808080808080) == 0;
+#endif
+    }
+
+    inline unsigned int date_value(const unsigned char* row, size_t pos, size_t len) noexcept
+    {
+        unsigned int value{ 0 };
+        for (size_t i = pos; i < pos + len; i++)
+            value = value * 10 + (row[i] - '0');
+        return value;
     }
-    if (comps[YEAR_COMP].length() == 2)
-        comps[YEAR_COMP].insert(0, std::to_string(century));
+}
+
+strDateConverter::strDateConverter()
+{
+    auto t = std::time(0);
+    std::tm now;
+    localtime_s(&now, &t);
+    century = now.tm_year / 100 + 19;
+}
+
+bool strDateConverter::setToFmt(const std::string& fmt)
+{
+    setValid(m_fromValid && setFmt(fmt, m_toFmt, m_toDelim, m_toPos, m_toLen, m_toSep, m_toValid));
+    if (m_valid)
+    {
+        // defines the order of converted components based on their position in the format
+        m_toOrder = { YEAR_COMP, MONTH_COMP, DAY_COMP };
+        for (unsigned char i = 0; i < 2; i++)
+            for (unsigned char j = i + 1; j < 3; j++)
+                if (m_toPos[m_toOrder[j]] < m_toPos[m_toOrder[i]])
+                    std::swap(m_toOrder[i], m_toOrder[j]);
+    }
+    return m_valid;
+}
+
+unsigned char strDateConverter::isValid(const unsigned char mode)
+{
+    unsigned char result = NONE;
+    if (m_fromValid && (mode & FROM) == FROM)
+        result = result | FROM;
+    if (m_toValid && (mode & TO) == TO)
+        result = result | TO;
+    return result;
+}
+
+bool strDateConverter::checkStrDate(std::string_view str) const noexcept
+{
+    if (auto entry = cached(str))
+        return entry->valid;
+    return uncachedCheck(str);
+}
+
+bool strDateConverter::uncachedCheck(std::string_view str) const noexcept
+{
+    if (m_fixedCheck != nullptr)
+    {
+        auto date = trimv(str);
+        if (date.length() == m_fixedSize)
+            return m_fixedCheck(date, century);
+    }
+    std::array<unsigned int, 3> vals;
+    return values(str, vals) && checkDate(vals[DAY_COMP], vals[MONTH_COMP], vals[YEAR_COMP]);
+}
+
+bool strDateConverter::serialDate(std::string_view str, std::int32_t& serial) const noexcept
+{
+    std::array<unsigned int, 3> vals;
+    return values(str, vals) && vals[YEAR_COMP] <= 9999 && checkDate(vals[DAY_COMP], vals[MONTH_COMP], vals[YEAR_COMP], serial);
+}
+
+size_t strDateConverter::serialToStr(std::int32_t serial, char* buffer) const noexcept
+{
+    if (!m_toValid)
+        return 0;
+    std::array<int, 3> vals;
+    serialToDate(serial, vals[DAY_COMP], vals[MONTH_COMP], vals[YEAR_COMP]);
+    if (vals[YEAR_COMP] < 0 || vals[YEAR_COMP] > 9999)
+        return 0;
+    std::array<unsigned char, 3> order{ YEAR_COMP, MONTH_COMP, DAY_COMP };
+    std::sort(order.begin(), order.end(), [this](unsigned char a, unsigned char b) { return m_toPos[a] < m_toPos[b]; });
+    size_t len{ 0 };
     for (unsigned char i = 0; i < 3; i++)
-        if (comps[i].length() < m_toLen[i])
-            comps[i].insert(0, 1, '0');         // no need to do it more than once
+    {
+        auto comp = order[i];
+        int value = comp == YEAR_COMP && m_toLen[comp] == 2 ? vals[comp] % 100 : vals[comp];
+        char digits[4];
+        auto [ptr, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+        size_t count = static_cast<size_t>(ptr - digits);
+        for (size_t pad = count; pad < m_toLen[comp]; pad++)
+            buffer[len++] = '0';
+        std::memcpy(buffer + len, digits, count);
+        len += count;
+        if (i < 2 && m_toDelim)
+            buffer[len++] = m_toSep;
+    }
+    return len;
+}
+
+std::string strDateConverter::convStrDate(std::string_view date) const
+{
+    char buffer[MAX_DATE_LENGTH];
+    return std::string(buffer, convStrDate(date, buffer));
+}
+
+size_t strDateConverter::convStrDate(std::string_view date, char* buffer) const noexcept
+{
+    if (auto entry = cached(date))
+    {
+        std::memcpy(buffer, entry->date, MAX_DATE_LENGTH);       // a fixed size copy is inlined
+        return entry->length;
+    }
+    return uncachedConv(date, buffer);
+}
+
+size_t strDateConverter::checkConvStrDate(std::string_view date, char* buffer) const noexcept
+{
+    if (auto entry = cached(date))
+    {
+        if (!entry->valid)
+            return 0;
+        std::memcpy(buffer, entry->date, MAX_DATE_LENGTH);
+        return entry->length;
+    }
+    return uncachedCheck(date) ? uncachedConv(date, buffer) : 0;
+}
+
+void strDateConverter::setCacheSize(size_t entries)
+{
+    size_t size{ 0 };
+    if (entries > 0)
+        for (size = 1; size < entries; size *= 2);
+    m_cache.resize(size);
+    m_cache.shrink_to_fit();
+    clearCache();
+}
+
+const strDateConverter::Cache_Entry* strDateConverter::cached(std::string_view date) const noexcept
+// returns the entry of the date, filled on a miss, or nullptr if the cache is disabled or the date too long to be a key
+{
+    if (m_cache.empty() || date.empty() || date.length() > CACHE_KEY_LENGTH)
+        return nullptr;
+    if (m_cacheCentury != century)
+        clearCache();
+    std::uint64_t words[2]{ 0, 0 };
+    std::memcpy(words, date.data(), date.length());
+    // the bits of the key are mixed by the finalizer of MurmurHash3 so that the low bits of the hash depend on all of them
+    std::uint64_t hash = words[0] ^ words[1] * 0x9E3779B97F4A7C15 ^ date.length();
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCD;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53;
+    hash ^= hash >> 33;
+    auto& entry = m_cache[static_cast<size_t>(hash) & (m_cache.size() - 1)];
+    if (entry.keyLength == date.length() && entry.key[0] == words[0] && entry.key[1] == words[1])
+    {
+        m_cacheHits++;
+        return &entry;
+    }
+    m_cacheMisses++;
+    entry.keyLength = static_cast<unsigned char>(date.length());
+    entry.key[0] = words[0];
+    entry.key[1] = words[1];
+    entry.valid = uncachedCheck(date);
+    entry.length = static_cast<unsigned char>(uncachedConv(date, entry.date));
+    return &entry;
+}
+
+void strDateConverter::clearCache() const noexcept
+{
+    for (auto& entry : m_cache)
+        entry.keyLength = EMPTY_ENTRY;
+    m_cacheCentury = century;
+    m_cacheHits = 0;
+    m_cacheMisses = 0;
+}
+
+size_t strDateConverter::uncachedConv(std::string_view date, char* buffer) const noexcept
+{
+    if (!m_valid)
+        return 0;
+    if (m_fixedConv != nullptr && date.length() == m_fixedSize)
+        return m_fixedConv(date, buffer, century);
+    std::array<std::string_view, 3> comps;
+    if (!components(date, comps) || comps[YEAR_COMP].length() > 4 || comps[MONTH_COMP].length() > 2 || comps[DAY_COMP].length() > 2)
+        return 0;
+    size_t len{ 0 };
     for (unsigned char i = 0; i < 3; i++)
     {
-        result += comps[m_toOrder[i]];
+        auto comp = comps[m_toOrder[i]];
+        if (m_toOrder[i] == YEAR_COMP && comp.length() == 2)
+        {
+            buffer[len++] = static_cast<char>('0' + century / 10 % 10);
+            buffer[len++] = static_cast<char>('0' + century % 10);
+        }
+        else if (comp.length() < m_toLen[m_toOrder[i]])
+            buffer[len++] = '0';        // no need to do it more than once
+        std::memcpy(buffer + len, comp.data(), comp.length());
+        len += comp.length();
         if (i < 2 && m_toDelim)
-            result += m_toSep;
+            buffer[len++] = m_toSep;
     }
-    return result;
+    return len;
+}
+
+size_t strDateConverter::convStrDates(const char* dates, size_t stride, size_t count, char* buffer, size_t bufferStride, std::vector<std::uint64_t>& invalid) const
+{
+    invalid.assign((count + 63) / 64, 0);
+    const Date_Layout from = date_layout(m_fromFmt.c_str());
+    const Date_Layout to = date_layout(m_toFmt.c_str());
+    if (!m_valid || !from.valid || !to.valid || from.size > 16 || to.size > MAX_DATE_LENGTH)
+    {
+        for (size_t i = 0; i < count; i++)
+            invalid[i / 64] |= static_cast<std::uint64_t>(1) << (i % 64);
+        return count;
+    }
+    const Date_Pattern pattern = date_pattern(m_fromFmt.c_str(), from);
+    const auto& masks = day_masks();
+    // the 16 first bytes of row hold the date and the next ones the separators and century digits of the converted date,
+    // so that each byte of the converted date is copied from row without branches
+    alignas(16) unsigned char row[32]{};
+    std::array<unsigned char, MAX_DATE_LENGTH> shuffle{};
+    for (size_t i = 0; i < to.size; i++)
+    {
+        shuffle[i] = static_cast<unsigned char>(16 + i);
+        row[16 + i] = static_cast<unsigned char>(m_toFmt[i]);
+    }
+    for (size_t comp = 0; comp < 3; comp++)
+    {
+        size_t dest = to.pos[comp];
+        size_t src = from.pos[comp];
+        if (to.len[comp] > from.len[comp])
+        {
+            row[16 + dest++] = static_cast<unsigned char>('0' + century / 10 % 10);
+            row[16 + dest++] = static_cast<unsigned char>('0' + century % 10);
+        }
+        else
+            src += from.len[comp] - to.len[comp];
+        for (; dest < to.pos[comp] + to.len[comp]; dest++)
+            shuffle[dest] = static_cast<unsigned char>(src++);
+    }
+    const unsigned int hundreds = from.len[YEAR_COMP] == 2 ? century * 100 : 0;
+    size_t errors{ 0 };
+    for (size_t i = 0; i < count; i++)
+    {
+        std::memcpy(row, dates + i * stride, from.size);
+        bool valid = match_pattern(row, pattern);
+        if (valid)
+        {
+            unsigned int month = date_value(row, from.pos[MONTH_COMP], 2);
+            unsigned int day = date_value(row, from.pos[DAY_COMP], 2);
+            valid = month <= 12 && day <= 31 && (masks[month] >> day & 1) != 0;
+            if (valid && month == 2 && day == 29)
+                valid = checkDate(29, 2, hundreds + date_value(row, from.pos[YEAR_COMP], from.len[YEAR_COMP]));
+        }
+        if (!valid)
+        {
+            invalid[i / 64] |= static_cast<std::uint64_t>(1) << (i % 64);
+            errors++;
+        }
+        char* dest = buffer + i * bufferStride;
+        for (size_t j = 0; j < to.size; j++)
+            dest[j] = static_cast<char>(row[shuffle[j]]);
+    }
+    return errors;
+}
+
+bool strDateConverter::setValid(bool valid) noexcept
+// selects the fixed converter of the formats, the checks of the from format being only used when the to format is valid too
+{
+    m_valid = valid;
+    clearCache();
+    m_fixedSize = 0;
+    m_fixedCheck = nullptr;
+    m_fixedConv = nullptr;
+    if (!m_valid)
+        return m_valid;
+    for (const auto& fixed : FIXED_DATE_CONVERTERS)
+        if (m_fromFmt == fixed.from && m_toFmt == fixed.to)
+        {
+            m_fixedSize = fixed.size;
+            m_fixedCheck = fixed.check;
+            m_fixedConv = fixed.conv;
+            break;
+        }
+    return m_valid;
+}
+
+bool strDateConverter::values(std::string_view str, std::array<unsigned int, 3>& vals) const noexcept
+// parses the trimmed date according to the from format, a 2-digit year being completed with the century
+{
+    if (!m_fromValid)
+        return false;
+    auto date = trimv(str);
+    if (date.length() > m_fromFmt.length() + 5)
+        return false;
+    std::array<std::string_view, 3> comps;
+    if (!components(date, comps))
+        return false;
+    for (size_t i = 0; i < 3; i++)
+    {
+        auto comp = comps[i];
+        if ((m_fromLen[i] == 2 || m_fromLen[i] == 4) && comp.length() != m_fromLen[i])
+            return false;
+        // from_chars accepts neither signs nor spaces, so the whole component must be made of digits
+        auto [ptr, ec] = std::from_chars(comp.data(), comp.data() + comp.length(), vals[i]);
+        if (ec != std::errc() || ptr != comp.data() + comp.length())
+            return false;
+    }
+    if (m_fromLen[YEAR_COMP] == 2)
+        vals[YEAR_COMP] += century * 100;
+    return true;
+}
+
+bool strDateConverter::components(std::string_view date, std::array<std::string_view, 3>& comps) const noexcept
+// finds the year, month and day components of the date according to the from format
+{
+    if (m_fromDelim)
+    {
+        std::array<std::string_view, 3> fields;
+        if (!split3(date, m_fromSep, fields))
+            return false;
+        for (unsigned char i = 0; i < 3; i++)
+            comps[i] = fields[m_fromPos[i]];
+    }
+    else
+    {
+        for (unsigned char i = 0; i < 3; i++)
+        {
+            if (date.length() <= m_fromPos[i])
+                return false;
+            comps[i] = date.substr(m_fromPos[i], m_fromLen[i]);
+        }
+    }
+    return true;
 }
 
 bool strDateConverter::setFmt(const std::string& fmt, std::string& m_fmt, bool& m_delim, std::array<unsigned char, 3>& m_pos, std::array<unsigned char, 3>& m_len, char& m_sep, bool& m_val)
@@ -361,8 +2226,8 @@ bool strDateConverter::setFmt(const std::string& fmt, std::string& m_fmt, bool&
     }
     if (m_delim)
     {
-        std::vector<std::string> comps = split(fmtc, m_sep);
-        if (comps.size() != 3)
+        std::array<std::string_view, 3> comps;
+        if (!split3(fmtc, m_sep, comps))
             return m_val = false;
         for (unsigned char i = 0; i < comps.size(); i++)
         {
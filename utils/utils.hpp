@@ -9,8 +9,23 @@
 
 #include <algorithm>
 #include <array>
+#include <condition_variable>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
 #include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 /*! \brief Defines the types of end of line EOL */
@@ -28,6 +43,109 @@ enum class EOL
 */
 std::string get_message(const char* fmt...);
 
+/*! \brief The value returned by format_arguments for a format string that gives a width or a precision with '*'. */
+inline constexpr size_t FORMAT_NOT_SUPPORTED{ SIZE_MAX };
+
+/*! \brief Returns the number of arguments expected by the given printf-style format string.
+
+	A doubled percent sign is not a conversion and prints one. A width or precision given by '*' is not supported and gives FORMAT_NOT_SUPPORTED.
+*/
+constexpr size_t format_arguments(const char* fmt) noexcept
+{
+	size_t n{ 0 };
+	for (; *fmt != '\0'; ++fmt)
+	{
+		if (*fmt != '%')
+			continue;
+		if (fmt[1] == '%')
+		{
+			++fmt;
+			continue;
+		}
+		for (const char* spec = fmt + 1; *spec != '\0' && (*spec == '-' || *spec == '+' || *spec == ' ' || *spec == '#' || *spec == '.' || *spec == '*'
+			|| (*spec >= '0' && *spec <= '9')); ++spec)
+			if (*spec == '*')
+				return FORMAT_NOT_SUPPORTED;
+		++n;
+	}
+	return n;
+}
+
+/*! \brief An argument of append_message that refers to the value to print without copying a string. */
+class Message_Arg
+{
+public:
+	Message_Arg(const char* s) noexcept : m_type{ Type::String }, m_str{ s == nullptr ? "(null)" : s } {}
+	Message_Arg(const std::string& s) noexcept : m_type{ Type::String }, m_str{ s } {}
+	Message_Arg(std::string_view s) noexcept : m_type{ Type::String }, m_str{ s } {}
+	Message_Arg(char c) noexcept : m_type{ Type::Char }, m_char{ c } {}
+	Message_Arg(bool b) noexcept : m_type{ Type::Bool }, m_int{ b } {}
+	template <typename T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T>, int> = 0>
+	Message_Arg(T i) noexcept : m_type{ Type::Int }, m_int{ i } {}
+	template <typename T, std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T>, int> = 0>
+	Message_Arg(T u) noexcept : m_type{ Type::Uint }, m_uint{ u } {}
+	template <typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+	Message_Arg(T d) noexcept : m_type{ Type::Float }, m_float{ static_cast<double>(d) } {}
+
+	/*! \brief Appends the value to buffer as specified by spec, the flags, width and precision of the conversion, and by conv, its letter. */
+	void append_to(std::string& buffer, std::string_view spec, char conv) const;
+
+private:
+	enum class Type { String, Char, Bool, Int, Uint, Float };
+
+	Type m_type;
+	std::string_view m_str{};
+	union
+	{
+		char m_char;
+		long long m_int;
+		unsigned long long m_uint;
+		double m_float;
+	};
+};
+
+/*! \brief Appends to buffer the message built from the format string fmt and the given arguments, already converted to Message_Arg.
+
+	This function is used by the templates append_message and format_message, that check the format string at compile time. It doesn't check it.
+*/
+void append_message(std::string& buffer, const char* fmt, const Message_Arg* args, size_t count);
+
+/*! \brief Appends to buffer the message built from the format string Fmt and the given arguments, in the printf style.
+
+	The format string is a template argument so that its number of conversions is checked against the number of arguments at compile time:
+	it must be a constexpr char array with linkage, i.e. declared at namespace scope as constexpr char FORMAT[] = "...".
+	Unlike get_message, the arguments are type-safe: std::string and std::string_view are printed as is, without c_str(), and a number is printed
+	according to its type whatever the length modifier of its conversion. Nothing is allocated when buffer has enough capacity, so a buffer reused
+	across calls saves the allocations of the messages built in loops.
+	\param Fmt		the format string; flags, width and precision are supported for strings and numbers, but not a width or precision given by '*'.
+	\param buffer	the string to which the message is appended.
+	\param args		the values to print, one per conversion specification of Fmt.
+*/
+template <const char* Fmt, typename... Args>
+void append_message(std::string& buffer, const Args&... args)
+{
+	static_assert(format_arguments(Fmt) != FORMAT_NOT_SUPPORTED, "a width or precision given by '*' is not supported");
+	static_assert(format_arguments(Fmt) == sizeof...(Args), "the number of arguments does not match the format string");
+	if constexpr (sizeof...(Args) == 0)
+		append_message(buffer, Fmt, nullptr, 0);
+	else
+	{
+		const std::array<Message_Arg, sizeof...(Args)> margs{ { Message_Arg(args)... } };
+		append_message(buffer, Fmt, margs.data(), margs.size());
+	}
+}
+
+/*! \brief Returns the message built from the format string Fmt and the given arguments.
+	\sa append_message
+*/
+template <const char* Fmt, typename... Args>
+std::string format_message(const Args&... args)
+{
+	std::string message{};
+	append_message<Fmt>(message, args...);
+	return message;
+}
+
 /*!	\brief Converts str to lower case
 */
 std::string to_lower(const std::string& str);
@@ -36,6 +154,30 @@ std::string to_lower(const std::string& str);
 */
 std::string to_upper(const std::string& str);
 
+/*!	\brief Converts src to lower case into dest that must have room for src.size() chars.
+
+	ASCII chars are converted by blocks of 16 (SSE2) or 32 (AVX2) chars, blocks containing non-ASCII chars are converted by std::tolower.
+	src and dest can be the same buffer.
+*/
+void to_lower(std::string_view src, char* dest) noexcept;
+
+/*!	\brief Converts src to upper case into dest that must have room for src.size() chars.
+	\sa to_lower(std::string_view, char*)
+*/
+void to_upper(std::string_view src, char* dest) noexcept;
+
+/*!	\brief Converts src to lower case into dest, whose capacity is reused. */
+inline void to_lower(std::string_view src, std::string& dest) { dest.resize(src.size()); to_lower(src, &dest[0]); }
+
+/*!	\brief Converts src to upper case into dest, whose capacity is reused. */
+inline void to_upper(std::string_view src, std::string& dest) { dest.resize(src.size()); to_upper(src, &dest[0]); }
+
+/*!	\brief Converts str to lower case in place. */
+inline void to_lower_inplace(std::string& str) noexcept { to_lower(str, &str[0]); }
+
+/*!	\brief Converts str to upper case in place. */
+inline void to_upper_inplace(std::string& str) noexcept { to_upper(str, &str[0]); }
+
 #ifdef _WIN32
 /*!	\brief Converts a string to utf-16 wide string using the specified codepage.
 	\warning This function is only implemented for Windows platforms.
@@ -48,12 +190,114 @@ std::string to_upper(const std::string& str);
 std::wstring str_to_wstr(const std::string& str, unsigned int codepage);
 #endif // _WIN32
 
-/*!	\brief Returns a list of paths matching the specified pattern that can contain *, ? (Windows, POSIX) and [..] (POSIX).
+/*!	\brief A compiled case insensitive filename pattern matcher.
+
+	The pattern can contain the wildcards * (any sequence of chars, even empty), ? (any char) and [..] (any char of the class).
+	A class can contain ranges like a-z and is negated if it begins with ! or ^. A ] right after the opening [ or the negation is part of the class.
+	An unterminated [ matches itself.
+	The pattern is compiled once by the constructor, and the function match does not allocate memory.
+	Case folding is limited to ASCII chars.
+*/
+class Glob
+{
+public:
+	/*! \brief Compiles the pattern. If classes is false, [ is an ordinary char. */
+	explicit Glob(std::string_view pattern, bool classes = true);
+	/*! \brief Returns true if the whole name matches the pattern. */
+	bool match(std::string_view name) const noexcept;
+#ifdef _WIN32
+	/*! \brief Returns true if the whole wide name matches the pattern. Wide chars outside the 8-bit range only match themselves, ? and *. */
+	bool match(std::wstring_view name) const noexcept;
+#endif // _WIN32
+
+private:
+	enum class Op : unsigned char { Char, Any, Star, Class };
+	struct Token
+	{
+		Op op{ Op::Char };
+		size_t value{ 0 };				// lower case char of Op::Char, index of the class of Op::Class
+	};
+	std::vector<Token> m_tokens{};
+	std::vector<std::array<bool, 256>> m_classes{};
+
+	template <typename Char>
+	bool match_impl(const Char* name, size_t len) const noexcept;
+};
+
+/*!	\brief Returns the sorted list of paths matching the specified pattern that can contain *, ? (Windows, POSIX) and [..] (POSIX).
+
+	Ending path separators are ignored. Wildcards are allowed in every component of the path, and the component ** matches any number of subdirectories, including none.
+	The names are matched case insensitively with the class Glob.
+	\param excludes	list of filename patterns: matching files are ignored and matching directories are not traversed.
+	\param threads	number of threads scanning the subdirectories in parallel, 0 for the number of hardware threads. By default, the directories are scanned by the calling thread only.
+
+	Symbolic links to directories are not followed by **, and directories that can't be read due to permissions are skipped.
+	The result is sorted so it does not depend on the order in which the directories are scanned.
+*/
+std::vector<std::filesystem::path> dir(const std::string& pattern, const std::vector<std::string>& excludes = {}, unsigned int threads = 1);
+
+/*!	\brief A lazy form of the function dir that returns the matching paths as they are discovered.
+
+	The directories are scanned by background threads and each matching path is returned by the function next as soon as it is found,
+	so the processing of the first files can start before the end of the enumeration. The paths are returned in the discovery order,
+	which is the order of the directory entries if a single thread scans the tree. The patterns are the same than for the function dir.
+	The destructor stops the scan.
+	\sa dir()
+*/
+class Dir_Reader
+{
+public:
+	/*! \brief Starts the scan of the pattern. The default is a single thread for a reproducible order. */
+	explicit Dir_Reader(const std::string& pattern, const std::vector<std::string>& excludes = {}, unsigned int threads = 1);
+	~Dir_Reader();
+	Dir_Reader(const Dir_Reader&) = delete;
+	Dir_Reader& operator=(const Dir_Reader&) = delete;
+	/*! \brief Waits for the next matching path and returns false at the end of the scan.
+	*	\throws The exception that stopped the scan, after the paths found before it.
+	*/
+	bool next(std::filesystem::path& path);
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+/*! \brief Identifies a file on the system: the device and the inode (POSIX) or the volume serial number and the file index (Windows).
+
+	Different paths of the same file, including hard links, have the same identifier.
+*/
+struct File_Id
+{
+	std::uint64_t device{ 0 };
+	std::uint64_t index{ 0 };
+
+	bool operator==(const File_Id& other) const noexcept { return device == other.device && index == other.index; }
+};
 
-	Ending path separators are ignored. Wildcards are only allowed in the filename part of the path.
-	\warning Wildcard [..] support is not yet implemented.
+/*! \brief Gets the identifier of a file. Returns false if the file can't be queried. */
+bool file_id(const std::filesystem::path& path, File_Id& id) noexcept;
+
+/*! \brief A set of files, used to remove the duplicates of a list of paths without sorting it.
+
+	Files are compared by their File_Id in a hash set, so different spellings of the same path and hard links are the same file.
+	If the identifier of a file can't be queried, its path is compared instead.
 */
-std::vector<std::filesystem::path> dir(const std::string& pattern);
+class File_Set
+{
+public:
+	/*! \brief Adds the file to the set and returns false if it was already in the set. */
+	bool insert(const std::filesystem::path& path);
+	/*! \brief Returns the number of files in the set. */
+	size_t size() const noexcept { return m_ids.size() + m_paths.size(); }
+
+private:
+	struct Hash
+	{
+		size_t operator()(const File_Id& id) const noexcept { return std::hash<std::uint64_t>()(id.index ^ (id.device * 0x9e3779b97f4a7c15ULL)); }
+	};
+	std::unordered_set<File_Id, Hash> m_ids{};
+	std::unordered_set<std::filesystem::path::string_type> m_paths{};
+};
 
 /*! \brief Detects the EOL char(s) used in a file.
 	Returns EOL::Unknown if the file does not exist or if EOL chars are not found in the 4096 bytes at end or begin of the file.
@@ -66,58 +310,603 @@ size_t EOL_length(const EOL eol_type);
 /*! \brief Returns the chars sequence of the EOL type. */
 std::string EOL_str(const EOL eol_type);
 
+/*! \brief A read-only memory mapping of a whole file.
+
+	The mapping is hinted for a sequential access (madvise on POSIX platforms, FILE_FLAG_SEQUENTIAL_SCAN on Windows platforms).
+	The content of the file is available through a string_view without any copy, it is valid until the mapping is closed.
+*/
+class MappedFile
+{
+public:
+	/*! \brief Default constructor. No file is mapped. */
+	MappedFile() = default;
+	/*! \brief Constructor that maps the given file.
+	*	\throws A filesystem_error exception if the file can't be opened or mapped.
+	*/
+	MappedFile(const std::filesystem::path& filepath) { open(filepath); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	/*! \brief Move constructor. */
+	MappedFile(MappedFile&& other) noexcept;
+	/*! \brief Move assignment. */
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	/*! \brief Destructor that unmaps the file. */
+	~MappedFile() { close(); }
+
+	/*! \brief Maps the given file, after closing the previous mapping.
+	*	\throws A filesystem_error exception if the file can't be opened or mapped.
+	*/
+	void open(const std::filesystem::path& filepath);
+	/*! \brief Unmaps the file. */
+	void close() noexcept;
+	/*! \brief Returns true if a file is mapped. An empty file is open but has no data. */
+	bool is_open() const noexcept { return m_open; }
+	/*! \brief Returns a pointer to the first char of the file. */
+	const char* data() const noexcept { return m_data; }
+	/*! \brief Returns the size of the file. */
+	size_t size() const noexcept { return m_size; }
+	/*! \brief Returns the content of the file. */
+	std::string_view view() const noexcept { return std::string_view(m_data, m_size); }
+
+private:
+	const char* m_data{ nullptr };
+	size_t m_size{ 0 };
+	bool m_open{ false };
+#ifdef _WIN32
+	void* m_file{ nullptr };
+	void* m_mapping{ nullptr };
+#else
+	int m_fd{ -1 };
+#endif // _WIN32
+};
+
+/*! \brief Loads files in the system cache in the background, before they are read.
+
+	A background thread opens each requested file and asks the system to read its beginning: posix_fadvise(POSIX_FADV_WILLNEED) on POSIX platforms,
+	sequential reads into a scratch buffer on Windows platforms. So the latency of the opening and of the first reads of the file is hidden.
+	Prefetching is only a hint: errors are ignored. The destructor drops the pending requests.
+*/
+class Prefetcher
+{
+public:
+	Prefetcher();
+	~Prefetcher();
+	Prefetcher(const Prefetcher&) = delete;
+	Prefetcher& operator=(const Prefetcher&) = delete;
+
+	/*! \brief Requests the prefetch of the given number of bytes at the beginning of the file. */
+	void prefetch(const std::filesystem::path& filepath, std::uintmax_t bytes = UINTMAX_MAX);
+	/*! \brief Waits for the completion of the pending requests. */
+	void wait();
+
+private:
+	std::mutex m_mutex{};
+	std::condition_variable m_cv{};
+	std::deque<std::pair<std::filesystem::path, std::uintmax_t>> m_requests{};
+	bool m_busy{ false };
+	bool m_stop{ false };
+	std::thread m_thread{};
+
+	void run();
+};
+
+/*! \brief A reader of the lines of a text file based on its EOL.
+
+	The lines are returned as string_view objects that point into a reusable buffer, without any copy. The EOL is searched with memchr
+	that is vectorized by the standard libraries. A line longer than the buffer makes it grow, so lines are never truncated.
+*/
+class LineReader
+{
+public:
+	/*! \brief Constructor that opens the given file.
+	*	\param eol The EOL of the file. If EOL::Unknown, it is detected by the function file_EOL. If no EOL is found, LF is used.
+	*	\param bufsize The initial size of the buffer.
+	*	\throws A filesystem_error exception if the file can't be opened.
+	*/
+	LineReader(const std::filesystem::path& filepath, EOL eol = EOL::Unknown, size_t bufsize = 1 << 20);
+
+	/*! \brief Reads the next line without its EOL and returns false at the end of the file.
+	*
+	*	The returned view is valid until the next call. The last line of the file is returned even if it does not end with an EOL.
+	*	\throws A filesystem_error exception if a read error occurs.
+	*/
+	bool getline(std::string_view& line);
+	/*! \brief Returns the EOL used to split the lines. */
+	EOL eol() const noexcept { return m_eol; }
+	/*! \brief Returns the number of lines read. */
+	size_t line_number() const noexcept { return m_lines; }
+
+private:
+	std::filesystem::path m_path;
+	std::ifstream m_in;
+	EOL m_eol;
+	char m_last;							// last char of the EOL
+	std::vector<char> m_buf;
+	size_t m_pos{ 0 };						// begin of the next line
+	size_t m_scan{ 0 };						// begin of the chars not yet scanned
+	size_t m_end{ 0 };						// end of the chars read
+	size_t m_lines{ 0 };
+	bool m_eof{ false };
+
+	bool fill();							// reads more chars, returns false at the end of the file
+};
+
+/*! \brief A buffered writer of output files.
+
+	The data are accumulated in large blocks aligned on 4 KB that are each written by a single write operation on the file.
+	The EOL of the written data can be converted on the fly to a target EOL, and the blocks can be written by a background thread
+	while the next block is filled. It is intended to write the output files that match the paths returned by ConsoleApp::getOutPath.
+*/
+class OutputWriter
+{
+public:
+	/*! \brief Constructor that creates or truncates the given file.
+	*	\param eol The target EOL. CR+LF, LF and CR sequences are converted to it. If EOL::Unknown, the data are written as they are.
+	*	\param background If true, the full blocks are written by a background thread.
+	*	\param blocksize The size of the blocks, rounded up to a multiple of 4 KB.
+	*	\throws A filesystem_error exception if the file can't be created.
+	*/
+	OutputWriter(const std::filesystem::path& filepath, EOL eol = EOL::Unknown, bool background = false, size_t blocksize = 1 << 20);
+	OutputWriter(const OutputWriter&) = delete;
+	OutputWriter& operator=(const OutputWriter&) = delete;
+	/*! \brief Destructor that closes the file. Errors are ignored, call close before to handle them. */
+	~OutputWriter();
+
+	/*! \brief Writes the given data, converting their EOL if a target EOL is set.
+	*	\throws A filesystem_error exception if a write error occurred, including in the background thread.
+	*/
+	void write(std::string_view data);
+	/*! \brief Writes the given line followed by the target EOL, or the EOL of the platform if the target EOL is unknown. */
+	void write_line(std::string_view line);
+	/*! \brief Writes the pending data to the file and waits for the end of the background writes. */
+	void flush();
+	/*! \brief Flushes the data, stops the background thread and closes the file. */
+	void close();
+	/*! \brief Returns the number of bytes passed to the file. */
+	std::uintmax_t bytes_written() const noexcept { return m_written; }
+
+private:
+	struct Block_Deleter { void operator()(char* block) const noexcept; };
+	using Block = std::unique_ptr<char[], Block_Deleter>;
+
+	std::filesystem::path m_path;
+	std::FILE* m_file{ nullptr };
+	std::string m_eol{};
+	bool m_cr{ false };						// last converted char was CR
+	size_t m_blocksize;
+	Block m_block;							// block being filled
+	size_t m_used{ 0 };
+	std::uintmax_t m_written{ 0 };
+	// background writes
+	bool m_background;
+	std::thread m_thread{};
+	std::mutex m_mutex{};
+	std::condition_variable m_cv{};
+	std::deque<std::pair<Block, size_t>> m_pending{};
+	std::vector<Block> m_free{};
+	size_t m_inflight{ 0 };
+	bool m_stop{ false };
+	std::exception_ptr m_error{};
+
+	void append(const char* data, size_t len);		// copies data without conversion
+	void submit();									// writes or queues the current block
+	void write_block(const char* data, size_t len);
+	void background_writes();
+	void check_error();
+};
+
+/*! \brief Defines the backends of the class Block_Reader */
+enum class IO_Backend
+{
+	Sync,			// a blocking read per block: pread (POSIX) or ReadFile (Windows)
+	Uring			// several reads in flight with io_uring (Linux), Sync if not supported
+};
+
+/*! \brief A sequential reader of a file by large blocks.
+
+	With the IO_Backend::Uring backend, up to depth blocks are read in advance with io_uring in buffers registered with the kernel,
+	so the reads overlap the processing of the previous blocks and cost a fraction of a system call each.
+	If io_uring is not available (kernel older than 5.1, platform other than Linux, or disabled by the system), the reader falls back
+	to the IO_Backend::Sync backend that reads each block when it is requested.
+*/
+class Block_Reader
+{
+public:
+	/*! \brief Constructor that opens the given file.
+	*	\param blocksize The size of the blocks, rounded up to a multiple of 4 KB.
+	*	\param depth The number of blocks read in advance by the IO_Backend::Uring backend.
+	*	\throws A filesystem_error exception if the file can't be opened.
+	*/
+	Block_Reader(const std::filesystem::path& filepath, IO_Backend backend = IO_Backend::Sync, size_t blocksize = 1 << 20, size_t depth = 4);
+	Block_Reader(const Block_Reader&) = delete;
+	Block_Reader& operator=(const Block_Reader&) = delete;
+	/*! \brief Destructor that cancels the reads in flight and closes the file. */
+	~Block_Reader();
+
+	/*! \brief Gets the next block of the file and returns false at the end of the file. The block is valid until the next call.
+	*	\throws A filesystem_error exception if a read error occurred.
+	*/
+	bool read(std::string_view& block);
+	/*! \brief Reads the next block of the file in buffer, that must hold blocksize() bytes, and returns its size, 0 at the end of the file.
+
+		With the IO_Backend::Sync backend the block is read directly in buffer. With the IO_Backend::Uring backend it is copied from the
+		registered buffer where the kernel has read it.
+	*	\throws A filesystem_error exception if a read error occurred.
+	*/
+	size_t read(char* buffer);
+	/*! \brief Returns the size of the blocks. */
+	size_t blocksize() const noexcept { return m_blocksize; }
+	/*! \brief Returns the backend in use, that can differ from the requested one after a fallback. */
+	IO_Backend backend() const noexcept { return m_uring ? IO_Backend::Uring : IO_Backend::Sync; }
+	/*! \brief Returns the size of the file. */
+	std::uintmax_t size() const noexcept { return m_size; }
+
+private:
+	struct Buffer_Deleter { void operator()(char* buffer) const noexcept; };
+	struct Uring;
+
+	std::filesystem::path m_path;
+	std::uintmax_t m_size{ 0 };
+	std::uintmax_t m_offset{ 0 };			// offset of the next block returned by read
+	size_t m_blocksize;
+	std::unique_ptr<char[], Buffer_Deleter> m_buffer;
+#ifdef _WIN32
+	void* m_file{ nullptr };
+#else
+	int m_fd{ -1 };
+#endif // _WIN32
+	std::unique_ptr<Uring> m_uring{};
+
+	size_t read_at(char* data, size_t len, std::uintmax_t offset);	// blocking read of len bytes or up to the end of the file
+};
+
+/*! \brief Returns the view without the spaces present at its left.
+
+	Only the bounds of the view are adjusted. Spaces are the chars of std::isspace in the C locale, and they are scanned by blocks of 16 chars (SSE2)
+	so long paddings of fixed width fields are skipped quickly.
+*/
+std::string_view ltrimv(std::string_view s) noexcept;
+
+/*! \brief Returns the view without the spaces present at its right.
+	\sa ltrimv()
+*/
+std::string_view rtrimv(std::string_view s) noexcept;
+
+/*! \brief Returns the view without the spaces present at both its left and right.
+	\sa ltrimv()
+*/
+inline std::string_view trimv(std::string_view s) noexcept { return ltrimv(rtrimv(s)); }
+
 /*! \brief Deletes in place the spaces present at the left of the given string. */
 static inline void ltrim(std::string& s)
 {
-	s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) { return !std::isspace(ch); }));
+	s.erase(0, s.size() - ltrimv(s).size());
 }
 
 /*! \brief Deletes in place the spaces present at the right of the given string. */
 static inline void rtrim(std::string& s)
 {
-	s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), s.end());
+	s.resize(rtrimv(s).size());
 }
 
 /*! \brief Deletes in place the spaces present at both left and right of the given string. */
 static inline void trim(std::string& s)
 {
-	ltrim(s);
 	rtrim(s);
+	ltrim(s);
 }
 
 /*! \brief Returns a string without left spaces. */
-static inline std::string ltrimc(std::string s)
+static inline std::string ltrimc(const std::string& s)
 {
-	ltrim(s);
-	return s;
+	return std::string(ltrimv(s));
 }
 
 /*! \brief Returns a string without right spaces. */
-static inline std::string rtrimc(std::string s)
+static inline std::string rtrimc(const std::string& s)
 {
-	rtrim(s);
-	return s;
+	return std::string(rtrimv(s));
 }
 
 /*! \brief Returns a string without both left and right spaces. */
-static inline std::string trimc(std::string s)
+static inline std::string trimc(const std::string& s)
 {
-	trim(s);
-	return s;
+	return std::string(trimv(s));
 }
 
-/*! \brief Returns the list of elements of the given string delimited by the given char. */
+/*! \brief Returns the list of elements of the given string delimited by the given char.
+
+	As with std::getline, an empty string has no element and a delimiter at the end of the string does not start an empty element.
+	\sa Splitter to get the elements without allocation.
+*/
 std::vector<std::string> split(const std::string& s, const char delim);
 
+/*! \brief A lazy splitter of a string into the fields delimited by a char.
+
+	The fields are string_view objects that point into the given string, so no memory is allocated. The delimiters are searched with memchr
+	that is vectorized by the standard libraries. A string with n delimiters has n + 1 fields, including the empty ones.
+*/
+class Splitter
+{
+public:
+	/*! \brief Constructor. The string must outlive the splitter and the returned fields. */
+	Splitter(std::string_view str, char delim) noexcept : m_str{ str }, m_delim{ delim } {}
+
+	/*! \brief Gets the next field and returns false after the last one. */
+	bool next(std::string_view& field) noexcept
+	{
+		if (m_done)
+			return false;
+		auto found = static_cast<const char*>(std::memchr(m_str.data() + m_pos, m_delim, m_str.size() - m_pos));
+		size_t end = found == nullptr ? m_str.size() : static_cast<size_t>(found - m_str.data());
+		field = m_str.substr(m_pos, end - m_pos);
+		m_done = found == nullptr;
+		m_pos = end + 1;
+		return true;
+	}
+	/*! \brief Replaces the content of fields with the remaining fields and returns their number. The capacity of fields is reused across calls. */
+	size_t split(std::vector<std::string_view>& fields)
+	{
+		fields.clear();
+		std::string_view field{};
+		while (next(field))
+			fields.push_back(field);
+		return fields.size();
+	}
+
+private:
+	std::string_view m_str;
+	char m_delim;
+	size_t m_pos{ 0 };
+	bool m_done{ false };
+};
+
+/*! \brief Replaces the content of fields with the fields of the given string delimited by the given char and returns their number.
+	\sa Splitter
+*/
+inline size_t split(std::string_view s, const char delim, std::vector<std::string_view>& fields) { return Splitter(s, delim).split(fields); }
+
+/*! \brief Returns the given string without its enclosing quotes, the doubled quotes inside being replaced with a single one.
+	A string that does not begin with a quote is returned as is.
+*/
+std::string unquote(std::string_view str, char quote = '"');
+
+/*! \brief A field of a record parsed by Delimited_Parser. */
+struct Field_Span
+{
+	size_t offset{ 0 };			// offset of the field in the record
+	size_t length{ 0 };			// length of the raw field, quotes included
+	bool quoted{ false };		// the field begins with a quote
+};
+
+/*! \brief A parser of delimited records with quoted fields.
+
+	Fields can be enclosed in quotes to contain the delimiter, and a quote inside a quoted field is doubled. The record is scanned by blocks of 64 chars:
+	the quotes and the delimiters of a block are turned into two bitmasks with SSE2 or AVX2 comparisons, the quoted regions are the prefix XOR of
+	the quotes mask, and the delimiters outside of them are the ends of the fields. So the cost does not depend on the number of quotes and delimiters.
+	Records must not contain EOL chars.
+*/
+class Delimited_Parser
+{
+public:
+	/*! \brief Constructor with the delimiter and the quote chars. */
+	explicit Delimited_Parser(char delim = ';', char quote = '"') noexcept : m_delim{ delim }, m_quote{ quote } {}
+
+	/*! \brief Replaces the content of fields with the spans of the fields of the record and returns their number.
+
+		A record with n delimiters outside of quotes has n + 1 fields. The capacity of fields is reused across calls.
+	*/
+	size_t parse(std::string_view record, std::vector<Field_Span>& fields) const;
+	/*! \brief Returns the value of the field of the record: the raw field if it is not quoted, otherwise the text between the quotes.
+
+		If the quoted text contains doubled quotes, they are replaced with single ones in buffer and the returned view points into buffer.
+		Otherwise the view points into the record.
+	*/
+	std::string_view value(std::string_view record, const Field_Span& field, std::string& buffer) const;
+
+private:
+	char m_delim;
+	char m_quote;
+};
+
 /*! \brief Returns true if the given date is valid.
 *	\warning This function use the Gregorian calendar rules which adoption depends on nations.
 */
 bool checkDate(int day, int month, int year);
 
+/*! \brief Returns the serial day number of the given date: the number of days since January 1st, 1970, negative before.
+
+	Serial day numbers are compared and subtracted as the dates they stand for, so they are suitable as sort and comparison keys.
+	The date is not checked, a day beyond the end of its month giving the serial of a day of the next month.
+	\warning This function use the proleptic Gregorian calendar.
+*/
+constexpr std::int32_t dateToSerial(int day, int month, int year) noexcept
+{
+	const int y = year - (month <= 2 ? 1 : 0);
+	const int era = (y >= 0 ? y : y - 399) / 400;
+	const int yoe = y - era * 400;									// year of era [0, 399]
+	const int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;	// day of year from March 1st [0, 365]
+	const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;			// day of era [0, 146096]
+	return era * 146097 + doe - 719468;
+}
+
+/*! \brief Sets day, month and year to the date of the given serial day number.
+	\sa dateToSerial
+*/
+constexpr void serialToDate(std::int32_t serial, int& day, int& month, int& year) noexcept
+{
+	const int z = serial + 719468;
+	const int era = (z >= 0 ? z : z - 146096) / 146097;
+	const int doe = z - era * 146097;
+	const int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	const int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	const int mp = (5 * doy + 2) / 153;
+	day = doy - (153 * mp + 2) / 5 + 1;
+	month = mp < 10 ? mp + 3 : mp - 9;
+	year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+/*! \brief Returns true if the given date is valid and then sets serial to its serial day number.
+	\sa dateToSerial
+*/
+inline bool checkDate(int day, int month, int year, std::int32_t& serial)
+{
+	if (!checkDate(day, month, year))
+		return false;
+	serial = dateToSerial(day, month, year);
+	return true;
+}
+
+/*! \brief The layout of a fixed width date format: its size and the position and length of its year, month and day components, in this order. */
+struct Date_Layout
+{
+	size_t size{ 0 };
+	std::array<size_t, 3> pos{ 0, 0, 0 };
+	std::array<size_t, 3> len{ 0, 0, 0 };
+	bool valid{ false };
+};
+
+/*! \brief Returns the layout of the given lower case date format, valid if it has dd, mm and yy or yyyy once each.
+
+	Any other char is a separator that must be found at the same place in the dates.
+*/
+constexpr Date_Layout date_layout(const char* fmt) noexcept
+{
+	Date_Layout layout{};
+	size_t current{ 3 };
+	for (; fmt[layout.size] != '\0'; ++layout.size)
+	{
+		const char c = fmt[layout.size];
+		const size_t comp = c == 'y' ? 0 : c == 'm' ? 1 : c == 'd' ? 2 : 3;
+		if (comp == 3)
+		{
+			current = 3;
+			continue;
+		}
+		if (comp != current)
+		{
+			if (layout.len[comp] != 0)
+				return layout;		// a component is found twice
+			layout.pos[comp] = layout.size;
+			current = comp;
+		}
+		++layout.len[comp];
+	}
+	layout.valid = (layout.len[0] == 2 || layout.len[0] == 4) && layout.len[1] == 2 && layout.len[2] == 2;
+	return layout;
+}
+
+/*! \brief The SAP date formats that the runtime converter dispatches to fixedDateConverter, YYYYMMDD being the internal format. */
+namespace date_formats
+{
+	inline constexpr char DDMMYYYY_DOT[] = "dd.mm.yyyy";
+	inline constexpr char MMDDYYYY_SLASH[] = "mm/dd/yyyy";
+	inline constexpr char MMDDYYYY_DASH[] = "mm-dd-yyyy";
+	inline constexpr char YYYYMMDD_DOT[] = "yyyy.mm.dd";
+	inline constexpr char YYYYMMDD_SLASH[] = "yyyy/mm/dd";
+	inline constexpr char YYYYMMDD_DASH[] = "yyyy-mm-dd";
+	inline constexpr char YYYYMMDD[] = "yyyymmdd";
+}
+
+/*! \brief A date converter between two fixed width formats known at compile time.
+
+	The formats are given as constexpr char arrays with linkage, as those of the date_formats namespace, and their layouts are resolved at
+	compile time: the conversion is an unrolled byte shuffle and the check reads the digits at fixed positions. A 2-digit year is completed
+	with the given century and a 4-digit year is truncated to its last 2 digits when needed.
+	\sa strDateConverter for the formats known at run time, which dispatches to this class for the formats of the date_formats namespace.
+*/
+template <const char* From, const char* To>
+class fixedDateConverter
+{
+public:
+	static constexpr Date_Layout from{ date_layout(From) };
+	static constexpr Date_Layout to{ date_layout(To) };
+	static_assert(from.valid && to.valid, "the date formats must have fixed width components");
+
+	/*! \brief Returns true if the given date has the from format and is valid. */
+	static bool checkStrDate(std::string_view date, unsigned int century) noexcept
+	{
+		if (date.size() != from.size || !separators(date))
+			return false;
+		std::array<unsigned int, 3> values{ 0, 0, 0 };
+		for (size_t i = 0; i < 3; ++i)
+			for (size_t j = from.pos[i]; j < from.pos[i] + from.len[i]; ++j)
+			{
+				const unsigned int digit = static_cast<unsigned char>(date[j]) - static_cast<unsigned int>('0');
+				if (digit > 9)
+					return false;
+				values[i] = values[i] * 10 + digit;
+			}
+		if (from.len[0] == 2)
+			values[0] += century * 100;
+		return checkDate(values[2], values[1], values[0]);
+	}
+	/*! \brief Writes in buffer the given date converted to the to format and returns its length, or 0 if the date doesn't have the from format.
+
+		Only the size and the separators of the date are checked, not its digits. No terminating null character is written.
+	*/
+	static size_t convStrDate(std::string_view date, char* buffer, unsigned int century) noexcept
+	{
+		if (date.size() != from.size || !separators(date))
+			return 0;
+		static constexpr std::array<int, to.size> shuffle{ make_shuffle() };
+		for (size_t i = 0; i < to.size; ++i)
+		{
+			const int source = shuffle[i];
+			if (source >= 0)
+				buffer[i] = date[static_cast<size_t>(source)];
+			else if (source == LITERAL)
+				buffer[i] = To[i];
+			else
+				buffer[i] = static_cast<char>('0' + (source == CENTURY_TENS ? century / 10 % 10 : century % 10));
+		}
+		return to.size;
+	}
+
+private:
+	static constexpr int LITERAL{ -1 };
+	static constexpr int CENTURY_TENS{ -2 };
+	static constexpr int CENTURY_UNITS{ -3 };
+
+	static constexpr std::array<int, to.size> make_shuffle() noexcept
+	// gives for each char of the converted date the index of the char to copy from the date, or a negative code
+	{
+		std::array<int, to.size> result{};
+		for (size_t i = 0; i < to.size; ++i)
+			result[i] = LITERAL;
+		for (size_t comp = 0; comp < 3; ++comp)
+		{
+			size_t dest = to.pos[comp];
+			size_t src = from.pos[comp];
+			if (to.len[comp] > from.len[comp])
+			{
+				result[dest++] = CENTURY_TENS;
+				result[dest++] = CENTURY_UNITS;
+			}
+			else
+				src += from.len[comp] - to.len[comp];
+			for (; dest < to.pos[comp] + to.len[comp]; ++dest)
+				result[dest] = static_cast<int>(src++);
+		}
+		return result;
+	}
+	static bool separators(std::string_view date) noexcept
+	{
+		for (size_t i = 0; i < from.size; ++i)
+			if (From[i] != 'd' && From[i] != 'm' && From[i] != 'y' && date[i] != From[i])
+				return false;
+		return true;
+	}
+};
+
 /*! \brief A string formatted date converter.
 * 
 *	This class implements a conversion tool for string formatted dates. After initialization of from and to format strings,
 *	the member function convDate gives a way to convert dates through a fastener, without analyzing all the conditions of the conversion.
+*	When both formats are among those of the date_formats namespace, the dates of the from format size are checked and converted by the
+*	matching fixedDateConverter.
+*	An optional cache of the last checked and converted dates can be enabled with setCacheSize. As the const member functions update it
+*	without locks, each thread must then use its own converter.
 */
 class strDateConverter
 {
@@ -132,9 +921,9 @@ public:
 	strDateConverter();
 
 	/*! \brief Sets the from and to format strings and the valid status based on success or fail of the fastener construction. */
-	bool setFormats(const std::string& from, const std::string& to) { setFromFmt(from); setToFmt(to); return m_valid = m_fromValid && m_toValid; }
+	bool setFormats(const std::string& from, const std::string& to) { setFromFmt(from); setToFmt(to); return setValid(m_fromValid && m_toValid); }
 	/*! \brief Sets the from format string. If the to format string is set, constructs the fastener and sets the valid status. */
-	bool setFromFmt(const std::string& fmt) { return m_valid = setFmt(fmt, m_fromFmt, m_fromDelim, m_fromPos, m_fromLen, m_fromSep, m_fromValid) && m_toValid; }
+	bool setFromFmt(const std::string& fmt) { return setValid(setFmt(fmt, m_fromFmt, m_fromDelim, m_fromPos, m_fromLen, m_fromSep, m_fromValid) && m_toValid); }
 	/*! \brief Returns the from format string. */
 	std::string fromFmt() { return m_fromFmt; }
 	/*! \brief Sets the to format string. If the from format string is set, constructs the fastener and sets the valid status. */
@@ -152,14 +941,72 @@ public:
 	* 
 	*	Always returns false if the from date string format is not valid.
 	*/
-	bool checkStrDate(const std::string& str);
+	bool checkStrDate(std::string_view str) const noexcept;
 
 	/*! \brief Returns a string formatted date converted from the given date using the formats previously set.
 	* 
 	*	Returns an empty string if the valid status of the fastener is not true. This function doesn't check the validity of the given string date.
 	*	Use the appropriate function checkStrDate to do this.
 	*/
-	std::string convStrDate(const std::string& date);
+	std::string convStrDate(std::string_view date) const;
+	/*! \brief Writes in buffer the date converted from the given date using the formats previously set and returns its length.
+
+		This overload neither allocates nor throws. The buffer must hold at least MAX_DATE_LENGTH chars, no terminating null character is written.
+		Returns 0 if the valid status of the fastener is not true or if a component of the date can't be found or is too long.
+		As with the other overload, the validity of the given date is not checked.
+	*/
+	size_t convStrDate(std::string_view date, char* buffer) const noexcept;
+
+	/*! \brief Returns true if the given string is a valid date compliant with the from format string and then sets serial to its serial day number.
+
+		A 2-digit year is completed with century as checkStrDate does. Serial day numbers can be compared or sorted instead of the dates.
+		\sa dateToSerial
+	*/
+	bool serialDate(std::string_view str, std::int32_t& serial) const noexcept;
+	/*! \brief Writes in buffer the date of the given serial day number formatted with the to format string and returns its length.
+
+		A 2-digit year is written modulo 100 and a 1-char component with no leading zero. The buffer must hold at least MAX_DATE_LENGTH chars,
+		no terminating null character is written. Returns 0 if the to format is not valid or if the year is not between 0 and 9999.
+	*/
+	size_t serialToStr(std::int32_t serial, char* buffer) const noexcept;
+
+	/*! \brief The maximum length of a converted date. */
+	static const size_t MAX_DATE_LENGTH = 10;
+
+	/*! \brief Converts a column of fixed width dates and returns the number of invalid ones.
+
+		The date i is read at dates + i * stride and converted at buffer + i * bufferStride. Both formats must have fixed width components
+		(see date_layout), the from format giving the width of the dates; a 4-digit year is truncated if the to format has a 2-digit year.
+		Each date is checked as checkStrDate does, without trimming: its digits and separators are checked with SIMD instructions and its day
+		with a table of the valid days of each month. The bit i of invalid is set if the date i is not valid, in which case the bytes written
+		for it are meaningless. If the converter is not valid or a format has not a fixed width, nothing is converted and all dates are invalid.
+		\param invalid	the bitmap of invalid dates, resized to (count + 63) / 64 words.
+	*/
+	size_t convStrDates(const char* dates, size_t stride, size_t count, char* buffer, size_t bufferStride, std::vector<std::uint64_t>& invalid) const;
+
+	/*! \brief Writes in buffer the converted date if the given string is a valid date compliant with the from format string and returns its length.
+
+		Returns 0 if the date is not valid. It is the function that benefits the most of the cache, whose entries hold both results.
+		\sa checkStrDate, convStrDate(std::string_view, char*)
+	*/
+	size_t checkConvStrDate(std::string_view date, char* buffer) const noexcept;
+
+	/*! \brief Sets the number of entries of the cache of the checked and converted dates, rounded up to a power of 2. 0, the default, disables it.
+
+		The cache is direct-mapped and keyed on the raw bytes of the dates, so a date that is repeated in a file is checked and converted once
+		as long as its entry isn't taken by another date. It is emptied when the formats or the century change, and its counters are reset.
+		Dates longer than CACHE_KEY_LENGTH are not cached.
+	*/
+	void setCacheSize(size_t entries);
+	/*! \brief Returns the number of entries of the cache. */
+	size_t cacheSize() const noexcept { return m_cache.size(); }
+	/*! \brief Returns the number of dates found in the cache. */
+	size_t cacheHits() const noexcept { return m_cacheHits; }
+	/*! \brief Returns the number of dates not found in the cache, then checked and converted. */
+	size_t cacheMisses() const noexcept { return m_cacheMisses; }
+
+	/*! \brief The maximum length of the dates kept in the cache. */
+	static const size_t CACHE_KEY_LENGTH = 16;
 
 	/*! \brief Sets or returns the century used to fill converted string date if needed.
 		
@@ -190,4 +1037,32 @@ private:
 	const unsigned char DAY_COMP = 2;
 
 	bool setFmt(const std::string& fmt, std::string& m_fmt, bool& m_delim, std::array<unsigned char, 3>& m_pos, std::array<unsigned char, 3>& m_len, char& m_sep, bool& m_val);
+	bool components(std::string_view date, std::array<std::string_view, 3>& comps) const noexcept;
+	bool values(std::string_view str, std::array<unsigned int, 3>& vals) const noexcept;
+	bool uncachedCheck(std::string_view str) const noexcept;
+	size_t uncachedConv(std::string_view date, char* buffer) const noexcept;
+
+	struct Cache_Entry
+	{
+		std::uint64_t key[CACHE_KEY_LENGTH / 8];	// zero padded, so that keys are compared as integers
+		unsigned char keyLength;		// EMPTY_ENTRY if the entry is free
+		bool valid;
+		unsigned char length;
+		char date[MAX_DATE_LENGTH];
+	};
+	static const unsigned char EMPTY_ENTRY = 0xFF;
+
+	const Cache_Entry* cached(std::string_view date) const noexcept;
+	void clearCache() const noexcept;
+
+	mutable std::vector<Cache_Entry> m_cache;
+	mutable unsigned int m_cacheCentury{ 0 };
+	mutable size_t m_cacheHits{ 0 };
+	mutable size_t m_cacheMisses{ 0 };
+	bool setValid(bool valid) noexcept;
+
+	// the fixedDateConverter specialization matching the formats, if any
+	size_t m_fixedSize{ 0 };
+	bool (*m_fixedCheck)(std::string_view, unsigned int) noexcept { nullptr };
+	size_t (*m_fixedConv)(std::string_view, char*, unsigned int) noexcept { nullptr };
 };
\ No newline at end of file
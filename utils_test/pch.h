@@ -6,5 +6,7 @@
 #pragma once
 
 #include <filesystem>
+#include <fstream>
+#include <iterator>
 
 #include "gtest/gtest.h"
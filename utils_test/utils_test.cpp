@@ -38,6 +38,70 @@ TEST(Testing_get_message, Mix)
 	EXPECT_STREQ(m.c_str(), "Format test 5 + 6 = eleven.");
 }
 
+TEST(Testing_get_message, No_Trailing_Null)
+{
+	auto m = get_message("%s-%i", "abc", 12);
+	EXPECT_EQ(m.size(), 6);
+	EXPECT_EQ(m, "abc-12");
+}
+
+namespace
+{
+	constexpr char TYPES[]{ "%s|%s|%s|%i|%u|%c" };
+	constexpr char NUMBERS[]{ "%d %hd %.2f" };
+	constexpr char PERCENT[]{ "100%% sure" };
+	constexpr char BOOLS[]{ "%s and %i" };
+	constexpr char WIDTHS[]{ "[%5s][%-5s][%.2s][%05i][%x][%8.3f]" };
+	constexpr char LONG_FIELDS[]{ "%s%200i" };
+	constexpr char LINE[]{ "line %i of %s;" };
+}
+
+TEST(Testing_format_message, Types)
+{
+	std::string astr{ "string" };
+	std::string_view aview{ "view" };
+	auto m = format_message<TYPES>(astr, aview, "literal", -5, 7u, 'x');
+	EXPECT_EQ(m, "string|view|literal|-5|7|x");
+	// the length modifiers are ignored as the type of the arguments is known
+	EXPECT_EQ(format_message<NUMBERS>(9223372036854775807LL, 70000, 1.005f), "9223372036854775807 70000 1.00");
+	EXPECT_EQ(format_message<PERCENT>(), "100% sure");
+	EXPECT_EQ(format_message<BOOLS>(true, false), "true and 0");
+}
+
+TEST(Testing_format_message, Width_And_Precision)
+{
+	std::string astr{ "abc" };
+	auto m = format_message<WIDTHS>(astr, astr, astr, 42, 255, 3.14159);
+	EXPECT_EQ(m, "[  abc][abc  ][ab][00042][ff][   3.142]");
+	std::string big(300, 'z');
+	EXPECT_EQ(format_message<LONG_FIELDS>(big, 1).size(), 500);
+}
+
+TEST(Testing_format_message, Buffer_Is_Reused)
+{
+	std::string buffer{};
+	buffer.reserve(64);
+	auto data = buffer.data();
+	for (int i = 1; i <= 3; ++i)
+		append_message<LINE>(buffer, i, std::string_view("3"));
+	EXPECT_EQ(buffer, "line 1 of 3;line 2 of 3;line 3 of 3;");
+	EXPECT_EQ(buffer.data(), data);
+	buffer.clear();
+	append_message<LINE>(buffer, 4, "4");
+	EXPECT_EQ(buffer, "line 4 of 4;");
+	EXPECT_EQ(buffer.data(), data);
+}
+
+TEST(Testing_format_message, Format_Arguments)
+{
+	// format_message and append_message don't compile when these counts differ from the number of arguments
+	static_assert(format_arguments("%s and %s") == 2, "two conversions");
+	static_assert(format_arguments("100%% %-8.3f") == 1, "a doubled percent sign is not a conversion");
+	static_assert(format_arguments("%*d") == FORMAT_NOT_SUPPORTED, "a width given by '*' is rejected");
+	static_assert(format_arguments("%.*s") == FORMAT_NOT_SUPPORTED, "a precision given by '*' is rejected");
+	EXPECT_EQ(format_arguments(""), 0);
+}
+
 TEST(Testing_to_lower, String_Is_Empty)
 {
 	std::string str{ "" };
@@ -66,6 +130,42 @@ TEST(Testing_to_upper, Mixed_String)
 	EXPECT_STREQ(m.c_str(), "A STRING TEST; IT TAKES 30 MINUTES TO RUN.");
 }
 
+TEST(Testing_to_lower, Buffer_And_In_Place)
+{
+	std::string src{ "Mixed CASE Record With A Long Key Column 0123456789 ABCDEFGHIJKLMNOPQRSTUVWXYZ @[`{" };
+	std::string expected{ "mixed case record with a long key column 0123456789 abcdefghijklmnopqrstuvwxyz @[`{" };
+	std::string dest{};
+	to_lower(std::string_view(src), dest);
+	EXPECT_EQ(dest, expected);
+	std::vector<char> buf(src.size());
+	to_upper(src, buf.data());
+	EXPECT_EQ(std::string(buf.begin(), buf.end()), to_upper(src));
+	to_lower_inplace(src);
+	EXPECT_EQ(src, expected);
+	to_upper_inplace(src);
+	EXPECT_EQ(src, "MIXED CASE RECORD WITH A LONG KEY COLUMN 0123456789 ABCDEFGHIJKLMNOPQRSTUVWXYZ @[`{");
+}
+
+TEST(Testing_to_lower, All_Chars)
+{
+	// every char at every position of the vectorized blocks, with and without non-ASCII chars in the block
+	for (size_t len : { 1, 15, 16, 17, 31, 32, 33, 70 })
+		for (int c = 0; c < 256; c++)
+			for (char other : { 'a', '\xe9' })
+			{
+				std::string src(len, other);
+				src[(c * 7) % len] = static_cast<char>(c);
+				std::string lower(len, ' '), upper(len, ' ');
+				for (size_t i = 0; i < len; i++)
+				{
+					lower[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(src[i])));
+					upper[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(src[i])));
+				}
+				EXPECT_EQ(to_lower(src), lower);
+				EXPECT_EQ(to_upper(src), upper);
+			}
+}
+
 namespace fs = std::filesystem;
 
 TEST(Dir_Test, Current_Path_Dir)
@@ -95,7 +195,121 @@ TEST(Dir_Test, Absolute_Path_Dir)
 	}
 }
 
-// TODO dir with patterns containing []
+TEST(Glob_Test, Wildcards)
+{
+	EXPECT_TRUE(Glob("msxml?.*").match("msxml3.dll"));
+	EXPECT_TRUE(Glob("MSXML?.*").match("msxml6.DLL"));
+	EXPECT_FALSE(Glob("msxml?.*").match("msxml.dll"));
+	EXPECT_TRUE(Glob("*").match(""));
+	EXPECT_TRUE(Glob("a**b*c").match("aXbYbZc"));
+	EXPECT_FALSE(Glob("a*b*c").match("aXbYbZ"));
+	EXPECT_TRUE(Glob("*.txt").match(".txt"));
+	EXPECT_FALSE(Glob("*.txt").match("file.txt.bak"));
+	EXPECT_FALSE(Glob("file").match("file1"));
+}
+
+TEST(Glob_Test, Classes)
+{
+	EXPECT_TRUE(Glob("file[0-9].txt").match("file5.txt"));
+	EXPECT_FALSE(Glob("file[0-9].txt").match("filex.txt"));
+	EXPECT_TRUE(Glob("[a-c]*").match("Bravo"));
+	EXPECT_TRUE(Glob("[!a-c]*").match("delta"));
+	EXPECT_FALSE(Glob("[^a-c]*").match("Charlie"));
+	EXPECT_TRUE(Glob("[]x]").match("]"));
+	EXPECT_TRUE(Glob("[a-]").match("-"));
+	EXPECT_TRUE(Glob("file[1").match("FILE[1"));
+	EXPECT_FALSE(Glob("file[1]", false).match("file1"));
+	EXPECT_TRUE(Glob("file[1]", false).match("file[1]"));
+}
+
+TEST(Dir_Test, Temp_Dir)
+{
+	auto d = fs::temp_directory_path() / "dir_test";
+	fs::create_directories(d);
+	for (auto name : { "a1.txt", "a2.txt", "b1.txt", "A3.TXT", "a1.dat" })
+		std::ofstream(d / name) << name;
+	auto result{ dir((d / "a?.txt").string()) };
+	std::sort(result.begin(), result.end());
+	ASSERT_EQ(result.size(), 3);
+	EXPECT_EQ(result[0].filename(), "A3.TXT");
+	EXPECT_EQ(result[1].filename(), "a1.txt");
+	EXPECT_EQ(result[2].filename(), "a2.txt");
+#ifndef _WIN32
+	EXPECT_EQ(dir((d / "[ab]1.*").string()).size(), 3);
+#endif // _WIN32
+	fs::remove_all(d);
+}
+
+TEST(Dir_Test, Recursive_Dir)
+{
+	auto d = fs::temp_directory_path() / "dir_recursive_test";
+	for (auto sub : { "1000/2020", "1000/2021", "2000/2020", "2000/old/2019", "3000" })
+		fs::create_directories(d / sub);
+	for (auto file : { "1000/2020/a.txt", "1000/2021/b.txt", "2000/2020/c.txt", "2000/old/2019/d.txt", "3000/e.txt", "f.txt", "1000/2020/a.bak" })
+		std::ofstream(d / file) << file;
+	auto names = [&](const std::vector<fs::path>& paths)
+	{
+		std::vector<std::string> result{};
+		for (auto& p : paths)
+			result.push_back(fs::relative(p, d).generic_string());
+		return result;
+	};
+	for (unsigned int threads : { 1, 4 })
+	{
+		std::vector<std::string> all{ "1000/2020/a.txt", "1000/2021/b.txt", "2000/2020/c.txt", "2000/old/2019/d.txt", "3000/e.txt", "f.txt" };
+		EXPECT_EQ(names(dir((d / "**" / "*.txt").string(), {}, threads)), all);
+		std::vector<std::string> y2020{ "1000/2020/a.bak", "1000/2020/a.txt", "2000/2020/c.txt" };
+		EXPECT_EQ(names(dir((d / "*" / "2020" / "*").string(), {}, threads)), y2020);
+		std::vector<std::string> excluded{ "1000/2020/a.txt", "1000/2021/b.txt", "2000/2020/c.txt", "3000/e.txt", "f.txt" };
+		EXPECT_EQ(names(dir((d / "**").string(), { "old", "*.bak" }, threads)).size(), 11);
+		EXPECT_EQ(names(dir((d / "**" / "*.txt").string(), { "old" }, threads)), excluded);
+	}
+	fs::remove_all(d);
+}
+
+TEST(Dir_Test, Dir_Reader)
+{
+	auto d = fs::temp_directory_path() / "dir_reader_test";
+	fs::create_directories(d / "sub");
+	for (auto name : { "a1.txt", "a2.txt", "b1.txt", "sub/a3.txt" })
+		std::ofstream(d / name) << name;
+	for (unsigned int threads : { 1, 4 })
+	{
+		Dir_Reader reader((d / "**" / "a*.txt").string(), {}, threads);
+		std::vector<fs::path> found{};
+		fs::path p{};
+		while (reader.next(p))
+			found.push_back(p);
+		EXPECT_FALSE(reader.next(p));
+		std::sort(found.begin(), found.end());
+		EXPECT_EQ(found, dir((d / "**" / "a*.txt").string()));
+		EXPECT_EQ(found.size(), 3);
+	}
+	{
+		Dir_Reader reader((d / "*").string());		// destroyed before the end of the scan
+		fs::path p{};
+		EXPECT_TRUE(reader.next(p));
+	}
+	fs::remove_all(d);
+}
+
+TEST(File_Set_Test, Same_Files)
+{
+	auto d = fs::temp_directory_path() / "file_set_test";
+	fs::create_directories(d / "sub");
+	std::ofstream(d / "a.txt") << "a";
+	std::ofstream(d / "b.txt") << "b";
+	fs::create_hard_link(d / "a.txt", d / "link.txt");
+	File_Set set{};
+	EXPECT_TRUE(set.insert(d / "a.txt"));
+	EXPECT_TRUE(set.insert(d / "b.txt"));
+	EXPECT_FALSE(set.insert(d / "sub" / ".." / "a.txt"));
+	EXPECT_FALSE(set.insert(d / "link.txt"));
+	EXPECT_TRUE(set.insert(d / "missing.txt"));
+	EXPECT_FALSE(set.insert(d / "sub" / ".." / "missing.txt"));
+	EXPECT_EQ(set.size(), 3);
+	fs::remove_all(d);
+}
 
 // TODO str_to_wstr tests
 
@@ -111,6 +325,270 @@ TEST(EOL_Test, Unix_File)
 	EXPECT_EQ(file_EOL(p), EOL::Unix);
 }
 
+TEST(Splitter_Test, Fields)
+{
+	std::vector<std::string_view> fields{};
+	EXPECT_EQ(split("a;bc;;d", ';', fields), 4);
+	EXPECT_EQ(fields, (std::vector<std::string_view>{ "a", "bc", "", "d" }));
+	EXPECT_EQ(split(";x;", ';', fields), 3);
+	EXPECT_EQ(fields, (std::vector<std::string_view>{ "", "x", "" }));
+	EXPECT_EQ(split("", ';', fields), 1);
+	Splitter splitter("1.2.2020", '.');
+	std::string_view field{};
+	std::string joined{};
+	while (splitter.next(field))
+		joined.append(field).append("|");
+	EXPECT_EQ(joined, "1|2|2020|");
+	EXPECT_FALSE(splitter.next(field));
+}
+
+TEST(Splitter_Test, Split_Compatibility)
+{
+	EXPECT_EQ(split("a;bc;;d", ';'), (std::vector<std::string>{ "a", "bc", "", "d" }));
+	EXPECT_EQ(split("a;b;", ';'), (std::vector<std::string>{ "a", "b" }));
+	EXPECT_TRUE(split("", ';').empty());
+}
+
+TEST(Delimited_Parser_Test, Quoted_Fields)
+{
+	Delimited_Parser parser{};
+	std::vector<Field_Span> fields{};
+	std::string buffer{};
+	std::string record{ "1000;\"Text; with delimiter\";\"He said \"\"hi\"\"\";;last" };
+	EXPECT_EQ(parser.parse(record, fields), 5);
+	EXPECT_EQ(parser.value(record, fields[0], buffer), "1000");
+	EXPECT_EQ(parser.value(record, fields[1], buffer), "Text; with delimiter");
+	EXPECT_TRUE(fields[1].quoted);
+	EXPECT_EQ(parser.value(record, fields[2], buffer), "He said \"hi\"");
+	EXPECT_EQ(parser.value(record, fields[3], buffer), "");
+	EXPECT_EQ(parser.value(record, fields[4], buffer), "last");
+	EXPECT_EQ(parser.parse("", fields), 1);
+	EXPECT_EQ(unquote("\"a\"\"b\""), "a\"b");
+	EXPECT_EQ(unquote("plain"), "plain");
+}
+
+TEST(Delimited_Parser_Test, Blocks)
+{
+	// the quoted regions and the fields cross the 64 chars blocks, the result is compared with a char by char parser
+	Delimited_Parser parser{ ',' };
+	std::vector<Field_Span> fields{};
+	unsigned int seed{ 12345 };
+	for (int n = 0; n < 500; n++)
+	{
+		std::string record{};
+		size_t len = n % 300;
+		for (size_t i = 0; i < len; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			auto r = (seed >> 16) % 10;
+			record += r == 0 ? '"' : r == 1 ? ',' : static_cast<char>('a' + r);
+		}
+		std::vector<size_t> ends{};
+		bool inside{ false };
+		for (size_t i = 0; i < record.size(); i++)
+		{
+			if (record[i] == '"')
+				inside = !inside;
+			else if (record[i] == ',' && !inside)
+				ends.push_back(i);
+		}
+		ends.push_back(record.size());
+		ASSERT_EQ(parser.parse(record, fields), ends.size());
+		size_t start{ 0 };
+		for (size_t i = 0; i < ends.size(); i++)
+		{
+			EXPECT_EQ(fields[i].offset, start);
+			EXPECT_EQ(fields[i].length, ends[i] - start);
+			start = ends[i] + 1;
+		}
+	}
+}
+
+TEST(Trim_Test, Views)
+{
+	std::string padded = std::string(70, ' ') + "SAP field\tvalue" + std::string(65, ' ') + "\r\n";
+	EXPECT_EQ(trimv(padded), "SAP field\tvalue");
+	EXPECT_EQ(ltrimv(padded).size(), padded.size() - 70);
+	EXPECT_EQ(rtrimv(padded).size(), 70 + 15);
+	EXPECT_EQ(trimv(std::string(100, ' ')), "");
+	EXPECT_EQ(trimv(""), "");
+	EXPECT_EQ(trimv("\f\xe9 a \xa0\f"), "\xe9 a \xa0");
+	for (size_t len = 0; len < 40; len++)
+		for (size_t pos = 0; pos < len; pos++)
+		{
+			std::string s(len, '\v');
+			s[pos] = 'x';
+			EXPECT_EQ(trimv(s), "x");
+		}
+	std::string str{ "  a b  " };
+	trim(str);
+	EXPECT_EQ(str, "a b");
+	EXPECT_EQ(ltrimc("  a "), "a ");
+	EXPECT_EQ(rtrimc("  a "), "  a");
+}
+
+TEST(MappedFile_Test, Map_File)
+{
+	auto p = fs::temp_directory_path() / "mappedfile_test.txt";
+	std::ofstream(p, std::ios_base::binary) << "first line\r\nsecond line\r\n";
+	{
+		MappedFile file(p);
+		EXPECT_TRUE(file.is_open());
+		EXPECT_EQ(file.view(), "first line\r\nsecond line\r\n");
+		MappedFile moved(std::move(file));
+		EXPECT_FALSE(file.is_open());
+		EXPECT_EQ(moved.size(), 25);
+	}
+	std::ofstream(p, std::ios_base::binary | std::ios_base::trunc);
+	{
+		MappedFile file(p);
+		EXPECT_TRUE(file.is_open());
+		EXPECT_TRUE(file.view().empty());
+	}
+	fs::remove(p);
+	EXPECT_THROW(MappedFile file(p), fs::filesystem_error);
+}
+
+TEST(Prefetcher_Test, Prefetch_Files)
+{
+	auto p = fs::temp_directory_path() / "prefetcher_test.txt";
+	std::ofstream(p, std::ios_base::binary) << std::string(100000, 'x');
+	{
+		Prefetcher prefetcher{};
+		prefetcher.prefetch(p);
+		prefetcher.prefetch(p, 4096);
+		prefetcher.prefetch(fs::temp_directory_path() / "prefetcher_missing.txt");		// errors are ignored
+		prefetcher.wait();
+		prefetcher.prefetch(p);			// dropped or completed by the destructor
+	}
+	fs::remove(p);
+}
+
+TEST(Block_Reader_Test, Read_Blocks)
+{
+	auto p = fs::temp_directory_path() / "block_reader_test.txt";
+	std::string content{};
+	for (int i = 0; i < 20000; i++)
+		content += std::to_string(i) + "\n";
+	std::ofstream(p, std::ios_base::binary) << content;
+	for (auto backend : { IO_Backend::Sync, IO_Backend::Uring })
+	{
+		Block_Reader reader(p, backend, 4096, 3);
+		EXPECT_EQ(reader.size(), content.size());
+		std::string result{};
+		std::string_view block{};
+		while (reader.read(block))
+		{
+			EXPECT_LE(block.size(), 4096);
+			result.append(block);
+		}
+		EXPECT_FALSE(reader.read(block));
+		EXPECT_EQ(result, content);
+		Block_Reader direct(p, backend, 4096, 3);
+		std::string buffer(direct.blocksize(), ' ');
+		result.clear();
+		while (size_t got = direct.read(buffer.data()))
+			result.append(buffer, 0, got);
+		EXPECT_EQ(result, content);
+	}
+	{
+		Block_Reader reader(p, IO_Backend::Uring, 4096, 8);		// destroyed with reads in flight
+		std::string_view block{};
+		EXPECT_TRUE(reader.read(block));
+	}
+	std::ofstream(p, std::ios_base::binary | std::ios_base::trunc);
+	Block_Reader empty(p, IO_Backend::Uring);
+	std::string_view block{};
+	EXPECT_FALSE(empty.read(block));
+	fs::remove(p);
+	EXPECT_THROW(Block_Reader{ p }, fs::filesystem_error);
+}
+
+TEST(LineReader_Test, Lines_Longer_Than_Buffer)
+{
+	auto p = fs::temp_directory_path() / "linereader_test.txt";
+	std::ofstream(p, std::ios_base::binary) << "short\r\na line longer than the buffer\r\n\r\nlast";
+	LineReader reader(p, EOL::Unknown, 8);
+	EXPECT_EQ(reader.eol(), EOL::Windows);
+	std::vector<std::string> lines{};
+	std::string_view line;
+	while (reader.getline(line))
+		lines.emplace_back(line);
+	EXPECT_EQ(lines, std::vector<std::string>({ "short", "a line longer than the buffer", "", "last" }));
+	EXPECT_EQ(reader.line_number(), 4);
+	fs::remove(p);
+}
+
+TEST(LineReader_Test, Mac_File)
+{
+	auto p = fs::temp_directory_path() / "linereader_test.txt";
+	std::ofstream(p, std::ios_base::binary) << "one\rtwo\r";
+	LineReader reader(p);
+	std::string_view line;
+	EXPECT_TRUE(reader.getline(line));
+	EXPECT_EQ(line, "one");
+	EXPECT_TRUE(reader.getline(line));
+	EXPECT_EQ(line, "two");
+	EXPECT_FALSE(reader.getline(line));
+	fs::remove(p);
+}
+
+TEST(OutputWriter_Test, EOL_Conversion)
+{
+	auto p = fs::temp_directory_path() / "outputwriter_test.txt";
+	{
+		OutputWriter writer(p, EOL::Windows);
+		writer.write("unix\nmac\rwindows\r");
+		writer.write("\nend");
+		writer.write_line("");
+		writer.close();
+		EXPECT_EQ(writer.bytes_written(), 25);
+	}
+	std::ifstream in(p, std::ios_base::binary);
+	std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	EXPECT_EQ(content, "unix\r\nmac\r\nwindows\r\nend\r\n");
+	in.close();
+	fs::remove(p);
+}
+
+TEST(OutputWriter_Test, Background_Blocks)
+{
+	auto p = fs::temp_directory_path() / "outputwriter_test.txt";
+	std::string expected{};
+	{
+		OutputWriter writer(p, EOL::Unknown, true, 4096);
+		for (int i = 0; i < 10000; i++)
+		{
+			auto line = "record " + std::to_string(i);
+			writer.write(line + "\n");
+			expected += line + "\n";
+		}
+	}
+	EXPECT_EQ(fs::file_size(p), expected.size());
+	std::ifstream in(p, std::ios_base::binary);
+	std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	EXPECT_EQ(content, expected);
+	in.close();
+	fs::remove(p);
+}
+
+#ifndef _WIN32
+TEST(OutputWriter_Test, Background_Write_Error)
+{
+	// every write to /dev/full fails with ENOSPC
+	if (!fs::exists("/dev/full"))
+		GTEST_SKIP();
+	OutputWriter writer("/dev/full", EOL::Unknown, true, 4096);
+	std::string block(4096, 'x');
+	EXPECT_THROW(
+		{
+			for (int i = 0; i < 100; i++)
+				writer.write(block);
+			writer.flush();
+		}, fs::filesystem_error);
+}
+#endif // _WIN32
+
 TEST(checkDate_Test, Valid_Date)
 {
 	EXPECT_TRUE(checkDate(29, 2, 2020));
@@ -119,6 +597,7 @@ TEST(checkDate_Test, Valid_Date)
 TEST(checkDate_Test, Not_Valid_Date)
 {
 	EXPECT_FALSE(checkDate(29, 2, 2100));
+	EXPECT_FALSE(checkDate(31, 2, 2020));
 }
 
 class strDateConverterTest : public ::testing::Test
@@ -172,4 +651,263 @@ TEST_F(strDateConverterTest, convStrDate)
 	EXPECT_STREQ(dc0.convStrDate("1.1.2020").c_str(), "20200101");
 	EXPECT_STREQ(dc1.convStrDate("29022020").c_str(), "29/02/2020");
 	EXPECT_STREQ(dc1.convStrDate("31042020").c_str(), "31/04/2020");	// convStrDate does not check if date is valid
-}
\ No newline at end of file
+}
+
+TEST_F(strDateConverterTest, convStrDate_Buffer)
+{
+	char buffer[strDateConverter::MAX_DATE_LENGTH];
+	size_t len = dc0.convStrDate("29.2.2020", buffer);
+	EXPECT_EQ(std::string_view(buffer, len), "20200229");
+	len = dc1.convStrDate("01032020", buffer);
+	EXPECT_EQ(std::string_view(buffer, len), "01/03/2020");
+	EXPECT_EQ(dc0.convStrDate("29.2", buffer), 0);
+	EXPECT_EQ(dc0.convStrDate("29.2.20201", buffer), 0);
+	EXPECT_EQ(dc1.convStrDate("0103", buffer), 0);
+	EXPECT_EQ(dc2.convStrDate("01032020", buffer), 0);
+	strDateConverter dc3;
+	dc3.century = 19;
+	dc3.setFormats("mm/dd/yy", "yyyy-mm-dd");
+	len = dc3.convStrDate("12/31/99", buffer);
+	EXPECT_EQ(std::string_view(buffer, len), "1999-12-31");
+}
+
+TEST_F(strDateConverterTest, checkStrDate_Strict)
+{
+	EXPECT_FALSE(dc0.checkStrDate("29.-2.2020"));
+	EXPECT_FALSE(dc0.checkStrDate("29.2x.2020"));
+	EXPECT_FALSE(dc0.checkStrDate("29..2020"));
+	EXPECT_FALSE(dc1.checkStrDate("2902"));
+	EXPECT_TRUE(dc1.checkStrDate(" 29022020 "));
+	strDateConverter dc3;
+	dc3.century = 21;
+	dc3.setFormats("dd.mm.yy", "yyyymmdd");
+	EXPECT_TRUE(dc3.checkStrDate("29.02.04"));		// 2104 is a leap year
+	dc3.century = 22;
+	EXPECT_FALSE(dc3.checkStrDate("29.02.00"));		// 2200 is not
+}
+
+TEST(fixedDateConverter_Test, Layout)
+{
+	constexpr auto layout = date_layout("dd.mm.yy");
+	static_assert(layout.valid && layout.size == 8, "dd.mm.yy is a valid layout");
+	EXPECT_EQ(layout.pos[0], 6);
+	EXPECT_EQ(layout.pos[1], 3);
+	EXPECT_EQ(layout.pos[2], 0);
+	EXPECT_FALSE(date_layout("d.m.yyyy").valid);
+	EXPECT_FALSE(date_layout("ddmmyyyydd").valid);
+	EXPECT_FALSE(date_layout("ddmmyyy").valid);
+}
+
+namespace
+{
+	constexpr char SHORT_US[] = "mm/dd/yy";
+}
+
+TEST(fixedDateConverter_Test, Conversions)
+{
+	using To_Internal = fixedDateConverter<date_formats::DDMMYYYY_DOT, date_formats::YYYYMMDD>;
+	char buffer[strDateConverter::MAX_DATE_LENGTH];
+	ASSERT_EQ(To_Internal::convStrDate("29.02.2020", buffer, 20), 8);
+	EXPECT_EQ(std::string_view(buffer, 8), "20200229");
+	EXPECT_EQ(To_Internal::convStrDate("29/02/2020", buffer, 20), 0);
+	EXPECT_EQ(To_Internal::convStrDate("29.2.2020", buffer, 20), 0);
+	EXPECT_TRUE(To_Internal::checkStrDate("29.02.2020", 20));
+	EXPECT_FALSE(To_Internal::checkStrDate("29.02.2100", 20));
+	EXPECT_FALSE(To_Internal::checkStrDate("29.0a.2020", 20));
+
+	using From_Short = fixedDateConverter<SHORT_US, date_formats::YYYYMMDD_DASH>;
+	ASSERT_EQ(From_Short::convStrDate("12/31/99", buffer, 19), 10);
+	EXPECT_EQ(std::string_view(buffer, 10), "1999-12-31");
+	EXPECT_TRUE(From_Short::checkStrDate("02/29/04", 21));
+	using To_Short = fixedDateConverter<date_formats::YYYYMMDD, SHORT_US>;
+	ASSERT_EQ(To_Short::convStrDate("20240731", buffer, 20), 8);
+	EXPECT_EQ(std::string_view(buffer, 8), "07/31/24");
+}
+
+TEST_F(strDateConverterTest, Fixed_Formats)
+{
+	strDateConverter dc3;
+	ASSERT_TRUE(dc3.setFormats("DD.MM.YYYY", "yyyymmdd"));
+	EXPECT_EQ(dc3.convStrDate("31.12.1999"), "19991231");
+	EXPECT_EQ(dc3.convStrDate("1.1.2020"), "20200101");		// not the fixed width, converted as before
+	EXPECT_TRUE(dc3.checkStrDate(" 29.02.2020"));
+	EXPECT_FALSE(dc3.checkStrDate("29.02.2100"));
+	EXPECT_FALSE(dc3.checkStrDate("29-02-2020"));
+	ASSERT_TRUE(dc3.setToFmt("mm/dd/yyyy"));
+	EXPECT_EQ(dc3.convStrDate("31.12.1999"), "12/31/1999");
+	ASSERT_TRUE(dc3.setFormats("yyyymmdd", "yyyy-mm-dd"));
+	EXPECT_EQ(dc3.convStrDate("20240229"), "2024-02-29");
+	EXPECT_FALSE(dc3.checkStrDate("20230229"));
+}
+
+TEST_F(strDateConverterTest, convStrDates)
+{
+	strDateConverter dc3;
+	ASSERT_TRUE(dc3.setFormats("yyyymmdd", "dd.mm.yyyy"));
+	// a column of 8 chars dates in 10 chars records
+	std::string column{ "20200229;;20210229;;20241231;;2024123x;;20240431;;20240100;;19991301;;" };
+	std::vector<std::uint64_t> invalid{};
+	std::string converted(7 * 12, ' ');
+	EXPECT_EQ(dc3.convStrDates(column.data(), 10, 7, converted.data(), 12, invalid), 5);
+	ASSERT_EQ(invalid.size(), 1);
+	EXPECT_EQ(invalid[0], 0b1111010);
+	EXPECT_EQ(converted.substr(0, 10), "29.02.2020");
+	EXPECT_EQ(converted.substr(24, 10), "31.12.2024");
+	for (size_t i = 0; i < 7; i++)
+		EXPECT_EQ((invalid[0] >> i & 1) == 0, dc3.checkStrDate(column.substr(i * 10, 8))) << i;
+
+	ASSERT_TRUE(dc3.setFormats("dd/mm/yy", "yyyymmdd"));
+	dc3.century = 21;
+	std::string dates{ "29/02/0429/02/0531-01-01" };
+	std::string result(24, ' ');
+	EXPECT_EQ(dc3.convStrDates(dates.data(), 8, 3, result.data(), 8, invalid), 2);
+	EXPECT_EQ(invalid[0], 0b110);
+	EXPECT_EQ(result.substr(0, 8), "21040229");
+
+	ASSERT_TRUE(dc3.setFormats("d.m.yyyy", "yyyymmdd"));
+	EXPECT_EQ(dc3.convStrDates(dates.data(), 8, 3, result.data(), 8, invalid), 3);
+}
+
+TEST_F(strDateConverterTest, convStrDates_Large_Column)
+{
+	strDateConverter dc3;
+	ASSERT_TRUE(dc3.setFormats("dd.mm.yyyy", "yyyymmdd"));
+	std::string column{};
+	for (int year = 1999; year <= 2001; year++)
+		for (int month = 0; month <= 13; month++)
+			for (int day = 0; day <= 32; day++)
+			{
+				char date[11];
+				std::snprintf(date, sizeof(date), "%02d.%02d.%04d", day, month, year);
+				column.append(date, 10);
+			}
+	const size_t count = column.size() / 10;
+	std::string converted(count * 8, ' ');
+	std::vector<std::uint64_t> invalid{};
+	size_t errors = dc3.convStrDates(column.data(), 10, count, converted.data(), 8, invalid);
+	EXPECT_EQ(errors, count - 3 * 365 - 1);
+	char buffer[strDateConverter::MAX_DATE_LENGTH];
+	for (size_t i = 0; i < count; i++)
+	{
+		std::string_view date(column.data() + i * 10, 10);
+		bool valid = dc3.checkStrDate(date);
+		ASSERT_EQ((invalid[i / 64] >> (i % 64) & 1) == 0, valid) << date;
+		if (valid)
+		{
+			ASSERT_EQ(std::string_view(converted.data() + i * 8, 8), std::string_view(buffer, dc3.convStrDate(date, buffer))) << date;
+		}
+	}
+}
+
+TEST(dateToSerial_Test, Round_Trip)
+{
+	static_assert(dateToSerial(1, 1, 1970) == 0, "the serial day numbers start on January 1st, 1970");
+	EXPECT_EQ(dateToSerial(31, 12, 1969), -1);
+	EXPECT_EQ(dateToSerial(1, 3, 2000), 11017);
+	EXPECT_EQ(dateToSerial(1, 3, 2100) - dateToSerial(28, 2, 2100), 1);
+	std::int32_t previous = dateToSerial(31, 12, 1599);
+	for (int year = 1600; year <= 2400; year++)
+		for (int month = 1; month <= 12; month++)
+			for (int day = 1; day <= 31; day++)
+			{
+				std::int32_t serial{ 0 };
+				if (!checkDate(day, month, year, serial))
+					continue;
+				ASSERT_EQ(serial, previous + 1) << day << '.' << month << '.' << year;
+				int d{ 0 }, m{ 0 }, y{ 0 };
+				serialToDate(serial, d, m, y);
+				ASSERT_TRUE(d == day && m == month && y == year) << serial;
+				previous = serial;
+			}
+}
+
+TEST_F(strDateConverterTest, Serial_Dates)
+{
+	strDateConverter dc3;
+	dc3.century = 20;
+	ASSERT_TRUE(dc3.setFormats("mm/dd/yy", "dd.mm.yyyy"));
+	std::int32_t first{ 0 }, second{ 0 };
+	ASSERT_TRUE(dc3.serialDate("12/31/99", first));
+	ASSERT_TRUE(dc3.serialDate(" 01/01/00 ", second));
+	EXPECT_EQ(first, dateToSerial(31, 12, 2099));
+	EXPECT_EQ(second, dateToSerial(1, 1, 2000));
+	EXPECT_LT(second, first);
+	EXPECT_FALSE(dc3.serialDate("02/29/01", first));
+	EXPECT_FALSE(dc3.serialDate("02/29", first));
+	char buffer[strDateConverter::MAX_DATE_LENGTH];
+	EXPECT_EQ(std::string_view(buffer, dc3.serialToStr(second, buffer)), "01.01.2000");
+	ASSERT_TRUE(dc3.setToFmt("m/d/yy"));
+	EXPECT_EQ(std::string_view(buffer, dc3.serialToStr(dateToSerial(5, 7, 2004), buffer)), "7/5/04");
+	ASSERT_TRUE(dc3.setToFmt("yyyymmdd"));
+	EXPECT_EQ(std::string_view(buffer, dc3.serialToStr(-1, buffer)), "19691231");
+	EXPECT_EQ(dc3.serialToStr(dateToSerial(1, 1, 10000), buffer), 0);
+	EXPECT_EQ(dc2.serialToStr(0, buffer), 0);
+}
+
+TEST_F(strDateConverterTest, Cache)
+{
+	strDateConverter dc3;
+	ASSERT_TRUE(dc3.setFormats("d.m.yyyy", "yyyymmdd"));
+	EXPECT_EQ(dc3.cacheSize(), 0);
+	dc3.setCacheSize(100);
+	EXPECT_EQ(dc3.cacheSize(), 128);
+	char buffer[strDateConverter::MAX_DATE_LENGTH];
+	const std::array<std::string, 4> dates{ "29.2.2020", "30.2.2020", "1.12.1999", "31.12.1999" };
+	for (int i = 0; i < 10; i++)
+		for (const auto& date : dates)
+		{
+			size_t len = dc3.checkConvStrDate(date, buffer);
+			EXPECT_EQ(len != 0, dc3.checkStrDate(date));
+			if (len != 0)
+			{
+				EXPECT_EQ(std::string_view(buffer, len), dc3.convStrDate(date));
+			}
+		}
+	EXPECT_EQ(dc3.cacheHits() + dc3.cacheMisses(), 4 * 10 * 2 + 3 * 10);	// the invalid date isn't converted
+	EXPECT_EQ(dc3.cacheMisses(), 4);
+	EXPECT_EQ(std::string_view(buffer, dc3.checkConvStrDate("31.12.1999", buffer)), "19991231");
+	EXPECT_EQ(dc3.checkConvStrDate("30.2.2020", buffer), 0);
+
+	// the cache is emptied when the formats or the century change
+	ASSERT_TRUE(dc3.setToFmt("dd/mm/yyyy"));
+	EXPECT_EQ(dc3.cacheHits() + dc3.cacheMisses(), 0);
+	EXPECT_EQ(dc3.convStrDate("1.12.1999"), "01/12/1999");
+	ASSERT_TRUE(dc3.setFormats("dd.mm.yy", "yyyymmdd"));
+	dc3.century = 20;
+	EXPECT_EQ(dc3.convStrDate("29.02.00"), "20000229");
+	dc3.century = 19;
+	EXPECT_EQ(dc3.convStrDate("29.02.00"), "19000229");
+	EXPECT_FALSE(dc3.checkStrDate("29.02.00"));
+	EXPECT_EQ(dc3.cacheMisses(), 1);
+	EXPECT_EQ(dc3.cacheHits(), 1);
+	dc3.setCacheSize(0);
+	EXPECT_EQ(dc3.convStrDate("29.02.00"), "19000229");
+	EXPECT_EQ(dc3.cacheMisses(), 0);
+}
+
+TEST_F(strDateConverterTest, Cache_Per_Thread)
+{
+	std::vector<std::thread> threads{};
+	std::vector<size_t> errors(4, 0);
+	for (size_t t = 0; t < errors.size(); t++)
+		threads.emplace_back([&errors, t]()
+			{
+				strDateConverter dc;
+				dc.setFormats("dd.mm.yyyy", "yyyymmdd");
+				dc.setCacheSize(64);
+				char buffer[strDateConverter::MAX_DATE_LENGTH];
+				for (int i = 0; i < 20000; i++)
+				{
+					std::string date = (i % 28 < 9 ? "0" : "") + std::to_string(i % 28 + 1) + ".0" + std::to_string(i % 9 + 1) + ".2020";
+					std::string expected = "20200" + std::to_string(i % 9 + 1) + date.substr(0, 2);
+					if (std::string_view(buffer, dc.checkConvStrDate(date, buffer)) != expected)
+						errors[t]++;
+				}
+				if (dc.cacheHits() == 0)
+					errors[t]++;
+			});
+	for (auto& thread : threads)
+		thread.join();
+	for (auto e : errors)
+		EXPECT_EQ(e, 0);
+}